@@ -0,0 +1,15 @@
+#ifndef RAYTRACER_ALLOC_COUNTER_HPP
+#define RAYTRACER_ALLOC_COUNTER_HPP
+
+#include <cstdint>
+
+namespace raytracer {
+
+// Number of global operator new calls made by the process so far, from all
+// threads. The difference of two readings is the heap traffic in between;
+// the counting operator new lives in src/raytracer/alloc_counter.cpp.
+uint64_t HeapAllocationCount();
+
+} // namespace raytracer
+
+#endif // RAYTRACER_ALLOC_COUNTER_HPP
@@ -0,0 +1,161 @@
+#ifndef RAYTRACER_ANTIALIAS_HPP
+#define RAYTRACER_ANTIALIAS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "raytracer/gbuffer.hpp"
+#include "raytracer/parallel.hpp"
+
+namespace raytracer {
+
+// Post-process antialiasing in the spirit of FXAA 3.11 (quality preset):
+// finds luma edges, walks along them to estimate where the stair step is
+// and blends each edge pixel with its neighbour across the edge. Object-ID
+// discontinuities mark silhouettes; inside an object a pixel needs
+// interiorContrastScale times more contrast, so shading detail stays sharp.
+class Antialiaser {
+public:
+    float edgeThreshold = 0.125f;      // contrast relative to the brightest local luma
+    float edgeThresholdMin = 0.0312f;  // absolute, relative to full scale
+    float interiorContrastScale = 2.0f;
+    float subpixelQuality = 0.75f;
+    int searchSteps = 8;
+    int tileSize = 32;
+
+    // Filters an RGB float image (3 floats per pixel, 0..scale) in place.
+    void Apply(std::vector<float>& color, const GBuffer& gbuf, float scale, ThreadPool& pool) {
+        width = gbuf.width;
+        height = gbuf.height;
+        const size_t pixelCount = static_cast<size_t>(width) * static_cast<size_t>(height);
+        if (width <= 0 || height <= 0 || color.size() != pixelCount * 3) return;
+
+        luma.resize(pixelCount);
+        output.resize(color.size());
+        const int tilesX = (width + tileSize - 1) / tileSize;
+        const int tilesY = (height + tileSize - 1) / tileSize;
+
+        pool.ParallelFor(height, 16, [&](int y0, int y1) {
+            for (size_t i = static_cast<size_t>(y0) * width; i < static_cast<size_t>(y1) * width; ++i) {
+                const float* c = &color[i * 3];
+                // sqrt approximates the display gamma, so contrast is perceptual
+                luma[i] = std::sqrt(scale * (0.299f * std::min(c[0], scale) + 0.587f * std::min(c[1], scale) +
+                                             0.114f * std::min(c[2], scale)));
+            }
+        });
+
+        pool.ParallelFor(tilesX * tilesY, 1, [&](int t0, int t1) {
+            for (int t = t0; t < t1; ++t) {
+                const int tx = (t % tilesX) * tileSize;
+                const int ty = (t / tilesX) * tileSize;
+                const int xEnd = std::min(width, tx + tileSize);
+                const int yEnd = std::min(height, ty + tileSize);
+                for (int y = ty; y < yEnd; ++y) {
+                    for (int x = tx; x < xEnd; ++x) {
+                        FilterPixel(color, gbuf, scale, x, y);
+                    }
+                }
+            }
+        });
+
+        color.swap(output);
+    }
+
+private:
+    std::vector<float> luma;
+    std::vector<float> output;
+    int width = 0;
+    int height = 0;
+
+    float Luma(int x, int y) const {
+        x = std::min(width - 1, std::max(0, x));
+        y = std::min(height - 1, std::max(0, y));
+        return luma[static_cast<size_t>(y) * width + x];
+    }
+
+    int Id(const GBuffer& gbuf, int x, int y) const {
+        x = std::min(width - 1, std::max(0, x));
+        y = std::min(height - 1, std::max(0, y));
+        return gbuf.samples[static_cast<size_t>(y) * width + x].objectId;
+    }
+
+    void FilterPixel(const std::vector<float>& color, const GBuffer& gbuf, float scale, int x, int y) {
+        const size_t idx = static_cast<size_t>(y) * width + x;
+        const float* src = &color[idx * 3];
+        float* dst = &output[idx * 3];
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+
+        const float lM = luma[idx];
+        const float lN = Luma(x, y - 1), lS = Luma(x, y + 1);
+        const float lW = Luma(x - 1, y), lE = Luma(x + 1, y);
+        const float lMin = std::min(lM, std::min(std::min(lN, lS), std::min(lW, lE)));
+        const float lMax = std::max(lM, std::max(std::max(lN, lS), std::max(lW, lE)));
+        const float range = lMax - lMin;
+
+        const int id = gbuf.samples[idx].objectId;
+        const bool silhouette = Id(gbuf, x, y - 1) != id || Id(gbuf, x, y + 1) != id ||
+                                Id(gbuf, x - 1, y) != id || Id(gbuf, x + 1, y) != id;
+        float threshold = std::max(edgeThresholdMin * scale, lMax * edgeThreshold);
+        if (!silhouette) threshold *= interiorContrastScale;
+        if (range < threshold) return;
+
+        const float lNW = Luma(x - 1, y - 1), lNE = Luma(x + 1, y - 1);
+        const float lSW = Luma(x - 1, y + 1), lSE = Luma(x + 1, y + 1);
+
+        const float edgeHorz = std::fabs(lNW + lSW - 2.0f * lW) + 2.0f * std::fabs(lN + lS - 2.0f * lM) +
+                               std::fabs(lNE + lSE - 2.0f * lE);
+        const float edgeVert = std::fabs(lNW + lNE - 2.0f * lN) + 2.0f * std::fabs(lW + lE - 2.0f * lM) +
+                               std::fabs(lSW + lSE - 2.0f * lS);
+        const bool horizontal = edgeHorz >= edgeVert;
+
+        // pick the side of the edge with the steeper gradient
+        const float l1 = horizontal ? lN : lW;
+        const float l2 = horizontal ? lS : lE;
+        const float g1 = std::fabs(l1 - lM);
+        const float g2 = std::fabs(l2 - lM);
+        const int side = g1 >= g2 ? -1 : 1;
+        const float gradientScaled = 0.25f * std::max(g1, g2);
+        const float localAverage = 0.5f * ((g1 >= g2 ? l1 : l2) + lM);
+
+        // luma halfway between the pixel row/column and its neighbour across the edge
+        auto edgeLuma = [&](int offset) {
+            return horizontal ? 0.5f * (Luma(x + offset, y) + Luma(x + offset, y + side))
+                              : 0.5f * (Luma(x, y + offset) + Luma(x + side, y + offset));
+        };
+
+        float end1 = 0.0f, end2 = 0.0f;
+        int dist1 = searchSteps, dist2 = searchSteps;
+        for (int i = 1; i <= searchSteps; ++i) {
+            end1 = edgeLuma(-i) - localAverage;
+            if (std::fabs(end1) >= gradientScaled) { dist1 = i; break; }
+        }
+        for (int i = 1; i <= searchSteps; ++i) {
+            end2 = edgeLuma(i) - localAverage;
+            if (std::fabs(end2) >= gradientScaled) { dist2 = i; break; }
+        }
+
+        const float nearest = static_cast<float>(std::min(dist1, dist2));
+        const float edgeLength = static_cast<float>(dist1 + dist2);
+        const float endLuma = dist1 < dist2 ? end1 : end2;
+        const bool centerSmaller = lM < localAverage;
+        float blend = ((endLuma < 0.0f) != centerSmaller) ? 0.5f - nearest / edgeLength : 0.0f;
+
+        const float lowpass = (2.0f * (lN + lS + lW + lE) + lNW + lNE + lSW + lSE) / 12.0f;
+        const float sub = std::min(1.0f, std::fabs(lowpass - lM) / range);
+        const float subSmooth = (-2.0f * sub + 3.0f) * sub * sub;
+        blend = std::max(blend, subSmooth * subSmooth * subpixelQuality);
+
+        const int nx = horizontal ? x : std::min(width - 1, std::max(0, x + side));
+        const int ny = horizontal ? std::min(height - 1, std::max(0, y + side)) : y;
+        const float* other = &color[(static_cast<size_t>(ny) * width + nx) * 3];
+        dst[0] = src[0] + (other[0] - src[0]) * blend;
+        dst[1] = src[1] + (other[1] - src[1]) * blend;
+        dst[2] = src[2] + (other[2] - src[2]) * blend;
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_ANTIALIAS_HPP
@@ -0,0 +1,192 @@
+#ifndef RAYTRACER_BVH_HPP
+#define RAYTRACER_BVH_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "raytracer/object.hpp"
+
+namespace raytracer {
+
+// 32-byte BVH node. Interior nodes have count == 0 and their children at
+// leftOrFirst and leftOrFirst + 1; leaves cover `count` primitives starting
+// at leftOrFirst.
+struct BvhNode {
+    float bmin[3];
+    uint32_t leftOrFirst;
+    float bmax[3];
+    uint32_t count;
+};
+
+// Ray against a node box for tEnter <= t <= tMax; inv is 1 / direction.
+template <typename T>
+inline bool BvhSlabTest(const BvhNode& node, const T org[3], const T inv[3], T tMax, T& tEnter) {
+    T t0 = T(0), t1 = tMax;
+    for (int a = 0; a < 3; ++a) {
+        T tn = (T(node.bmin[a]) - org[a]) * inv[a];
+        T tf = (T(node.bmax[a]) - org[a]) * inv[a];
+        if (tn > tf) std::swap(tn, tf);
+        t0 = tn > t0 ? tn : t0;
+        t1 = tf < t1 ? tf : t1;
+    }
+    tEnter = t0;
+    return t0 <= t1;
+}
+
+// BVH over whole objects by their bounding boxes. It is the top level of the
+// scene's two-level structure (RayTracer) and the bottom level of shared
+// instance geometry; meshes carry their own triangle BVH. Objects without
+// finite bounds (Object::IsBounded) are kept in a list tested by every ray.
+// Buffers keep their capacity, so rebuilding every frame does not allocate.
+class ObjectBvh {
+public:
+    void Build(const std::vector<std::unique_ptr<Object>>& objects) {
+        nodes.clear();
+        items.clear();
+        unbounded.clear();
+        boxes.resize(objects.size());
+        for (size_t i = 0; i < objects.size(); ++i) {
+            const Object& object = *objects[i];
+            if (!object.IsBounded()) {
+                unbounded.push_back(static_cast<uint32_t>(i));
+                continue;
+            }
+            Vec3 min, max;
+            object.GetBoundingBox(min, max);
+            // flat boxes (disks, bounded planes) get some thickness so
+            // grazing rays do not produce 0 * inf in the slab test
+            const Vec3 extent = max - min;
+            const float pad = 1e-4f * (1.0f + std::max(extent.x, std::max(extent.y, extent.z)));
+            boxes[i] = {{min.x - pad, min.y - pad, min.z - pad}, {max.x + pad, max.y + pad, max.z + pad}};
+            items.push_back(static_cast<uint32_t>(i));
+        }
+        if (items.empty()) return;
+
+        // median splits keep the depth at log2(objects), well inside the
+        // traversal stack
+        nodes.push_back(BvhNode());
+        tasks.clear();
+        tasks.push_back({0, 0, static_cast<uint32_t>(items.size())});
+        while (!tasks.empty()) {
+            const Task task = tasks.back();
+            tasks.pop_back();
+            float cmin[3], cmax[3];
+            BvhNode& node = nodes[task.node];
+            for (int a = 0; a < 3; ++a) {
+                node.bmin[a] = cmin[a] = std::numeric_limits<float>::max();
+                node.bmax[a] = cmax[a] = -std::numeric_limits<float>::max();
+            }
+            for (uint32_t i = task.first; i < task.first + task.count; ++i) {
+                const Box& box = boxes[items[i]];
+                for (int a = 0; a < 3; ++a) {
+                    node.bmin[a] = std::min(node.bmin[a], box.min[a]);
+                    node.bmax[a] = std::max(node.bmax[a], box.max[a]);
+                    cmin[a] = std::min(cmin[a], box.Center(a));
+                    cmax[a] = std::max(cmax[a], box.Center(a));
+                }
+            }
+            node.leftOrFirst = task.first;
+            node.count = task.count;
+            if (task.count <= kLeafSize) continue;
+
+            // median split along the widest spread of box centres
+            int axis = 0;
+            for (int a = 1; a < 3; ++a) {
+                if (cmax[a] - cmin[a] > cmax[axis] - cmin[axis]) axis = a;
+            }
+            if (cmax[axis] <= cmin[axis]) continue;
+            const uint32_t half = task.count / 2;
+            std::nth_element(items.begin() + task.first, items.begin() + task.first + half,
+                             items.begin() + task.first + task.count, [&](uint32_t a, uint32_t b) {
+                                 return boxes[a].Center(axis) < boxes[b].Center(axis);
+                             });
+            const uint32_t left = static_cast<uint32_t>(nodes.size());
+            node.leftOrFirst = left;
+            node.count = 0;
+            nodes.push_back(BvhNode());
+            nodes.push_back(BvhNode());
+            tasks.push_back({left, task.first, half});
+            tasks.push_back({left + 1, task.first + half, task.count - half});
+        }
+    }
+
+    bool Empty() const { return nodes.empty() && unbounded.empty(); }
+    bool HasUnbounded() const { return !unbounded.empty(); }
+    const std::vector<uint32_t>& Unbounded() const { return unbounded; }
+
+    // Union of the bounded objects' boxes; false if there are none.
+    bool GetBounds(Vec3& min, Vec3& max) const {
+        if (nodes.empty()) return false;
+        min = Vec3(nodes[0].bmin[0], nodes[0].bmin[1], nodes[0].bmin[2]);
+        max = Vec3(nodes[0].bmax[0], nodes[0].bmax[1], nodes[0].bmax[2]);
+        return true;
+    }
+
+    // Calls visit(index) for every object whose box the ray enters before
+    // tMax, unbounded objects first. tMax is re-read as visit shrinks it;
+    // visit returns true to stop the traversal.
+    template <typename T, typename Visit>
+    void Traverse(const RayT<T>& ray, const T& tMax, Visit&& visit) const {
+        for (uint32_t index : unbounded) {
+            if (visit(index)) return;
+        }
+        if (nodes.empty()) return;
+        const T org[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+        const T inv[3] = {T(1) / ray.direction.x, T(1) / ray.direction.y, T(1) / ray.direction.z};
+
+        uint32_t stack[64];
+        int sp = 0;
+        T tEnter;
+        if (!BvhSlabTest(nodes[0], org, inv, tMax, tEnter)) return;
+        uint32_t current = 0;
+        while (true) {
+            const BvhNode& node = nodes[current];
+            if (node.count > 0) {
+                for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+                    if (visit(items[i])) return;
+                }
+            } else {
+                const uint32_t left = node.leftOrFirst;
+                T tl, tr;
+                const bool hitL = BvhSlabTest(nodes[left], org, inv, tMax, tl);
+                const bool hitR = BvhSlabTest(nodes[left + 1], org, inv, tMax, tr);
+                if (hitL && hitR) {
+                    const bool leftFirst = tl <= tr;
+                    if (sp < 64) stack[sp++] = leftFirst ? left + 1 : left;
+                    current = leftFirst ? left : left + 1;
+                    continue;
+                }
+                if (hitL || hitR) {
+                    current = hitL ? left : left + 1;
+                    continue;
+                }
+            }
+            if (sp == 0) break;
+            current = stack[--sp];
+        }
+    }
+
+private:
+    static constexpr uint32_t kLeafSize = 2;
+
+    struct Box {
+        float min[3], max[3];
+        float Center(int axis) const { return 0.5f * (min[axis] + max[axis]); }
+    };
+    struct Task {
+        uint32_t node, first, count;
+    };
+
+    std::vector<BvhNode> nodes;
+    std::vector<uint32_t> items;      // object indices in leaf order
+    std::vector<uint32_t> unbounded;
+    std::vector<Box> boxes;           // by object index
+    std::vector<Task> tasks;
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_BVH_HPP
@@ -5,9 +5,28 @@
 #include <algorithm>
 #include "raytracer/vec3.hpp"
 #include "raytracer/ray.hpp"
+#include "raytracer/simd.hpp"
 
 namespace raytracer {
 
+// Camera basis for one frame: maps screen coordinates to primary ray
+// directions without recomputing the basis per pixel, 8 pixels at a time.
+struct RayGenerator {
+    Vec3 origin;
+    Vec3 forward;
+    Vec3 right;   // scaled by aspectRatio * tan(fov / 2)
+    Vec3 up;      // scaled by tan(fov / 2)
+    float invWidth = 1.0f;
+    float invHeight = 1.0f;
+
+    Vec3x8 Directions(Float8 screenX, Float8 screenY) const {
+        Float8 ndcX = screenX * Float8(2.0f * invWidth) - Float8(1.0f);
+        Float8 ndcY = Float8(1.0f) - screenY * Float8(2.0f * invHeight);
+        Vec3x8 dir = Vec3x8(forward) + Vec3x8(right) * ndcX + Vec3x8(up) * ndcY;
+        return dir.Normalized();
+    }
+};
+
 class Camera {
 public:
     Vec3 position;
@@ -64,6 +83,18 @@ public:
         return Ray(position, direction);
     }
 
+    RayGenerator GetRayGenerator(float screenWidth, float screenHeight) const {
+        float tanHalfFov = tan(fov * 3.14159f / 180.0f * 0.5f);
+        RayGenerator gen;
+        gen.origin = position;
+        gen.forward = GetForward();
+        gen.right = GetRight() * (aspectRatio * tanHalfFov);
+        gen.up = GetUp() * tanHalfFov;
+        gen.invWidth = 1.0f / screenWidth;
+        gen.invHeight = 1.0f / screenHeight;
+        return gen;
+    }
+
     void MoveForward(float deltaTime) {
         Vec3 forward = GetForward();
         position += forward * currentMoveSpeed * deltaTime;
@@ -0,0 +1,104 @@
+#ifndef RAYTRACER_COLOR_HPP
+#define RAYTRACER_COLOR_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "raytracer/simd.hpp"
+#include "dr4/math/color.hpp"
+
+namespace raytracer {
+
+constexpr int kSrgbEncodeLutSize = 4096;
+
+inline float SrgbToLinear(float c) {
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+inline float LinearToSrgb(float c) {
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+// Linear value of every 8-bit sRGB code.
+inline const std::array<float, 256>& SrgbDecodeLut() {
+    static const std::array<float, 256> lut = [] {
+        std::array<float, 256> t{};
+        for (int i = 0; i < 256; ++i) t[static_cast<size_t>(i)] = SrgbToLinear(static_cast<float>(i) / 255.0f);
+        return t;
+    }();
+    return lut;
+}
+
+// 8-bit sRGB code of linear values 0, 1/(N-1), ..., 1.
+inline const std::array<uint8_t, kSrgbEncodeLutSize>& SrgbEncodeLut() {
+    static const std::array<uint8_t, kSrgbEncodeLutSize> lut = [] {
+        std::array<uint8_t, kSrgbEncodeLutSize> t{};
+        for (int i = 0; i < kSrgbEncodeLutSize; ++i) {
+            float v = LinearToSrgb(static_cast<float>(i) / static_cast<float>(kSrgbEncodeLutSize - 1));
+            t[static_cast<size_t>(i)] = static_cast<uint8_t>(v * 255.0f + 0.5f);
+        }
+        return t;
+    }();
+    return lut;
+}
+
+// Linear RGB floats (3 per pixel) -> 8-bit sRGB. Out-of-range values are
+// clamped by min/max on the table index, which keeps the loop branch-free.
+inline void EncodeSrgb(const float* rgb, size_t pixelCount, dr4::Color* out) {
+    const uint8_t* lut = SrgbEncodeLut().data();
+    const float maxIndex = static_cast<float>(kSrgbEncodeLutSize - 1);
+
+    // 8 pixels = 24 channels = three Float8 at a time, then the table lookups
+    size_t i = 0;
+    for (; i + Float8::kLanes <= pixelCount; i += Float8::kLanes) {
+        alignas(32) int32_t index[3 * Float8::kLanes];
+        for (int k = 0; k < 3; ++k) {
+            Float8 c = Float8::Load(rgb + i * 3 + k * Float8::kLanes);
+            // data first: Max returns its second operand for NaN, so NaN maps to 0
+            c = Min(Max(c * Float8(maxIndex), Float8(0.0f)), Float8(maxIndex)) + Float8(0.5f);
+            ToInt(c, index + k * Float8::kLanes);
+        }
+        for (int p = 0; p < Float8::kLanes; ++p) {
+            out[i + p] = dr4::Color(lut[index[p * 3]], lut[index[p * 3 + 1]], lut[index[p * 3 + 2]]);
+        }
+    }
+    for (; i < pixelCount; ++i) {
+        const float* c = rgb + i * 3;
+        int r = static_cast<int>(std::min(maxIndex, std::max(0.0f, c[0] * maxIndex)) + 0.5f);
+        int g = static_cast<int>(std::min(maxIndex, std::max(0.0f, c[1] * maxIndex)) + 0.5f);
+        int b = static_cast<int>(std::min(maxIndex, std::max(0.0f, c[2] * maxIndex)) + 0.5f);
+        out[i] = dr4::Color(lut[r], lut[g], lut[b]);
+    }
+}
+
+// Floating-point linear RGB radiance/reflectance used inside the integrators.
+struct ColorF {
+    float r, g, b;
+
+    ColorF() : r(0), g(0), b(0) {}
+    ColorF(float r_, float g_, float b_) : r(r_), g(g_), b(b_) {}
+
+    // dr4 colours (object colours, UI) are sRGB encoded.
+    static ColorF FromSrgb(const dr4::Color& c) {
+        const std::array<float, 256>& lut = SrgbDecodeLut();
+        return ColorF(lut[c.r], lut[c.g], lut[c.b]);
+    }
+
+    ColorF operator+(const ColorF& o) const { return ColorF(r + o.r, g + o.g, b + o.b); }
+    ColorF operator*(const ColorF& o) const { return ColorF(r * o.r, g * o.g, b * o.b); }
+    ColorF operator*(float k) const { return ColorF(r * k, g * k, b * k); }
+    ColorF operator/(float k) const { return ColorF(r / k, g / k, b / k); }
+
+    ColorF& operator+=(const ColorF& o) { r += o.r; g += o.g; b += o.b; return *this; }
+    ColorF& operator*=(const ColorF& o) { r *= o.r; g *= o.g; b *= o.b; return *this; }
+    ColorF& operator*=(float k) { r *= k; g *= k; b *= k; return *this; }
+
+    float MaxComponent() const { return std::max(r, std::max(g, b)); }
+    bool IsBlack() const { return r <= 0.0f && g <= 0.0f && b <= 0.0f; }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_COLOR_HPP
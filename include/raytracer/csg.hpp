@@ -0,0 +1,290 @@
+#ifndef RAYTRACER_CSG_HPP
+#define RAYTRACER_CSG_HPP
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include "raytracer/object.hpp"
+
+namespace raytracer {
+
+enum class CsgOp {
+    Union,
+    Intersection,
+    Difference,  // left minus right
+};
+
+inline const char* CsgOpName(CsgOp op) {
+    switch (op) {
+        case CsgOp::Union: return "Union";
+        case CsgOp::Intersection: return "Intersection";
+        case CsgOp::Difference: return "Difference";
+    }
+    return "CSG";
+}
+
+// Stretch of a ray inside a solid, with the outward normals at both ends.
+template <typename T>
+struct CsgSpan {
+    T tIn, tOut;
+    Vec3T<T> nIn, nOut;
+};
+
+// Sorted, disjoint spans of one ray; fixed capacity so intersection does
+// not allocate.
+template <typename T>
+struct CsgSpans {
+    static constexpr int kMax = 16;
+    CsgSpan<T> span[kMax];
+    int count = 0;
+
+    void Add(const CsgSpan<T>& s) {
+        if (count < kMax) span[count++] = s;
+    }
+};
+
+// Boolean combination of two solids. The children sit in the node's frame
+// (relative to its position) and may themselves be Csg nodes; rotating or
+// scaling the node moves the whole tree. A ray is intersected with each
+// child as a list of inside spans, which are merged by the operation;
+// a child whose box the ray misses contributes no spans, and a miss that
+// decides the result (either side of an intersection, the left side of a
+// difference) skips the other child entirely.
+class Csg : public ObjectImpl<Csg> {
+public:
+    Csg(CsgOp op_, std::unique_ptr<Object> left_, std::unique_ptr<Object> right_, const std::string& name_ = "CSG")
+        : ObjectImpl(name_), op(op_), left(std::move(left_)), right(std::move(right_)) {
+        leftBox = ChildBox(*left);
+        rightBox = ChildBox(*right);
+    }
+
+    CsgOp Op() const { return op; }
+    const Object& Left() const { return *left; }
+    const Object& Right() const { return *right; }
+
+    template <typename T>
+    HitResultT<T> IntersectT(const RayT<T>& ray) const {
+        HitResultT<T> result;
+        const RayT<T> local = RayT<T>::FromUnit(ray.origin - Vec3T<T>(position), ray.direction);
+        CsgSpans<T> spans;
+        Spans(local, spans);
+        const T eps = HitEpsilon<T>();
+        for (int i = 0; i < spans.count; ++i) {
+            const CsgSpan<T>& s = spans.span[i];
+            if (s.tOut <= eps) continue;
+            const bool entering = s.tIn > eps;
+            const T t = entering ? s.tIn : s.tOut;
+            if (t == std::numeric_limits<T>::infinity()) break;
+            result.hit = true;
+            result.t = t;
+            result.point = ray.At(t);
+            result.normal = entering ? s.nIn : s.nOut;
+            result.object = this;
+            break;
+        }
+        return result;
+    }
+
+    void GetLocalBoundingBox(Vec3& min, Vec3& max) const override {
+        min = leftBox.min;
+        max = leftBox.max;
+        if (op == CsgOp::Union) {
+            min = Vec3(std::min(min.x, rightBox.min.x), std::min(min.y, rightBox.min.y), std::min(min.z, rightBox.min.z));
+            max = Vec3(std::max(max.x, rightBox.max.x), std::max(max.y, rightBox.max.y), std::max(max.z, rightBox.max.z));
+        } else if (op == CsgOp::Intersection) {
+            min = Vec3(std::max(min.x, rightBox.min.x), std::max(min.y, rightBox.min.y), std::max(min.z, rightBox.min.z));
+            max = Vec3(std::min(max.x, rightBox.max.x), std::min(max.y, rightBox.max.y), std::min(max.z, rightBox.max.z));
+            max = Vec3(std::max(max.x, min.x), std::max(max.y, min.y), std::max(max.z, min.z));
+        }
+        min += position;
+        max += position;
+    }
+
+    bool ContainsLocalPoint(const Vec3& point) const override {
+        const Vec3 p = point - position;
+        return Combine(op, left->SolidContainsPoint(p), right->SolidContainsPoint(p));
+    }
+
+    bool IsBounded() const override {
+        switch (op) {
+            case CsgOp::Union: return left->IsBounded() && right->IsBounded();
+            case CsgOp::Intersection: return left->IsBounded() || right->IsBounded();
+            case CsgOp::Difference: return left->IsBounded();
+        }
+        return true;
+    }
+
+private:
+    // Child box in the node's frame; unbounded children (planes as half
+    // spaces) are never culled.
+    struct Box {
+        Vec3 min, max;
+        bool bounded = true;
+        const Csg* node = nullptr;  // the child when it is a Csg itself
+    };
+
+    CsgOp op;
+    std::unique_ptr<Object> left;
+    std::unique_ptr<Object> right;
+    Box leftBox;
+    Box rightBox;
+
+    static constexpr int kMaxHitsPerChild = 8;
+
+    static Box ChildBox(const Object& child) {
+        Box box;
+        child.GetBoundingBox(box.min, box.max);
+        box.bounded = child.IsBounded();
+        box.node = dynamic_cast<const Csg*>(&child);
+        const Vec3 pad(1e-4f, 1e-4f, 1e-4f);
+        box.min -= pad;
+        box.max += pad;
+        return box;
+    }
+
+    static bool Combine(CsgOp op, bool inLeft, bool inRight) {
+        switch (op) {
+            case CsgOp::Union: return inLeft || inRight;
+            case CsgOp::Intersection: return inLeft && inRight;
+            case CsgOp::Difference: return inLeft && !inRight;
+        }
+        return false;
+    }
+
+    template <typename T>
+    static bool RayHitsBox(const RayT<T>& ray, const Box& box) {
+        if (!box.bounded) return true;
+        const T lo[3] = {T(box.min.x), T(box.min.y), T(box.min.z)};
+        const T hi[3] = {T(box.max.x), T(box.max.y), T(box.max.z)};
+        const T o[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+        const T d[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+        T t0 = T(0), t1 = std::numeric_limits<T>::max();
+        for (int a = 0; a < 3; ++a) {
+            const T inv = T(1) / d[a];
+            T tn = (lo[a] - o[a]) * inv;
+            T tf = (hi[a] - o[a]) * inv;
+            if (tn > tf) std::swap(tn, tf);
+            t0 = tn > t0 ? tn : t0;
+            t1 = tf < t1 ? tf : t1;
+        }
+        return t0 <= t1;
+    }
+
+    // Inside spans of a child from its successive hits: a hit facing the
+    // ray opens a span, one facing away closes it (or, as the first hit,
+    // closes a span that starts at the origin). An unbounded child may
+    // contain the origin without ever being hit, so its span at the origin
+    // comes from the inside test.
+    template <typename T>
+    static void ChildSpans(const Object& child, const RayT<T>& ray, CsgSpans<T>& out) {
+        const T inf = std::numeric_limits<T>::infinity();
+        bool inside = !child.IsBounded() && child.SolidContainsPoint(Vec3(ray.origin));
+        CsgSpan<T> open{T(0), T(0), -ray.direction, Vec3T<T>()};
+        T t = T(0);
+        for (int i = 0; i < kMaxHitsPerChild; ++i) {
+            const HitResultT<T> hit = child.Intersect(RayT<T>::FromUnit(ray.At(t), ray.direction));
+            if (!hit.hit) break;
+            t += hit.t;
+            if (hit.normal.Dot(ray.direction) < T(0)) {
+                if (inside) continue;  // inconsistent normals: keep the open span
+                open.tIn = t;
+                open.nIn = hit.normal;
+                inside = true;
+            } else {
+                if (!inside) open = CsgSpan<T>{T(0), T(0), -ray.direction, Vec3T<T>()};
+                open.tOut = t;
+                open.nOut = hit.normal;
+                out.Add(open);
+                inside = false;
+            }
+        }
+        if (inside) {
+            open.tOut = inf;
+            open.nOut = ray.direction;
+            out.Add(open);
+        }
+    }
+
+    template <typename T>
+    static void ObjectSpans(const Object& child, const Box& box, const RayT<T>& ray, CsgSpans<T>& out) {
+        out.count = 0;
+        if (!RayHitsBox(ray, box)) return;
+        if (box.node && box.node->transform.IsIdentity()) {
+            box.node->Spans(RayT<T>::FromUnit(ray.origin - Vec3T<T>(box.node->position), ray.direction), out);
+        } else {
+            ChildSpans(child, ray, out);
+        }
+    }
+
+    template <typename T>
+    void Spans(const RayT<T>& ray, CsgSpans<T>& out) const {
+        out.count = 0;
+        CsgSpans<T> a, b;
+        ObjectSpans(*left, leftBox, ray, a);
+        if (a.count == 0 && op != CsgOp::Union) return;
+        ObjectSpans(*right, rightBox, ray, b);
+        if (b.count == 0) {
+            if (op == CsgOp::Intersection) return;
+            out = a;
+            return;
+        }
+        if (a.count == 0) {
+            out = b;
+            return;
+        }
+        Merge(a, b, out);
+    }
+
+    // Sweep over the span boundaries of both children in order, emitting a
+    // span whenever the combined inside state changes. Right-hand normals
+    // flip for a difference, where its surface bounds the result from
+    // outside.
+    template <typename T>
+    void Merge(const CsgSpans<T>& a, const CsgSpans<T>& b, CsgSpans<T>& out) const {
+        const T inf = std::numeric_limits<T>::infinity();
+        const T flip = op == CsgOp::Difference ? T(-1) : T(1);
+        auto boundary = [inf](const CsgSpans<T>& s, int i) {
+            if (i >= 2 * s.count) return inf;
+            return i % 2 == 0 ? s.span[i / 2].tIn : s.span[i / 2].tOut;
+        };
+        int ia = 0, ib = 0;
+        bool inA = false, inB = false, in = false;
+        CsgSpan<T> open{};
+        while (ia < 2 * a.count || ib < 2 * b.count) {
+            const T ta = boundary(a, ia), tb = boundary(b, ib);
+            if (ta == inf && tb == inf) break;  // only the ends of open spans are left
+            Vec3T<T> normal;
+            T t;
+            if (ia < 2 * a.count && (ib >= 2 * b.count || ta <= tb)) {
+                t = ta;
+                normal = ia % 2 == 0 ? a.span[ia / 2].nIn : a.span[ia / 2].nOut;
+                inA = ia++ % 2 == 0;
+            } else {
+                t = tb;
+                normal = (ib % 2 == 0 ? b.span[ib / 2].nIn : b.span[ib / 2].nOut) * flip;
+                inB = ib++ % 2 == 0;
+            }
+            const bool now = Combine(op, inA, inB);
+            if (now == in) continue;
+            in = now;
+            if (in) {
+                open.tIn = t;
+                open.nIn = normal;
+            } else {
+                open.tOut = t;
+                open.nOut = normal;
+                out.Add(open);
+            }
+        }
+        if (in) {
+            open.tOut = inf;
+            out.Add(open);
+        }
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_CSG_HPP
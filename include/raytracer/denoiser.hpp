@@ -0,0 +1,113 @@
+#ifndef RAYTRACER_DENOISER_HPP
+#define RAYTRACER_DENOISER_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "raytracer/gbuffer.hpp"
+#include "raytracer/parallel.hpp"
+
+namespace raytracer {
+
+// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010): repeated 5x5
+// B3-spline passes with doubling tap spacing, where each tap is weighted by
+// colour, normal and depth similarity and rejected across object IDs.
+class Denoiser {
+public:
+    int iterations = 4;
+    float colorSigma = 1.0f;    // relative to full scale, at 1 sample per pixel
+    float normalSigma = 0.3f;
+    float depthSigma = 0.1f;    // relative to the centre pixel depth
+
+    // Filters an RGB float image (3 floats per pixel, 0..scale) in place.
+    void Apply(std::vector<float>& color, const GBuffer& gbuf, int samplesPerPixel,
+               float scale, ThreadPool& pool) {
+        const int width = gbuf.width;
+        const int height = gbuf.height;
+        if (width <= 0 || height <= 0 || color.size() != static_cast<size_t>(width) * height * 3) return;
+
+        // the display clips at full scale anyway; unclipped fireflies would
+        // fail every colour test and survive the filter
+        for (float& c : color) c = std::min(c, scale);
+
+        scratch.resize(color.size());
+        std::vector<float>* src = &color;
+        std::vector<float>* dst = &scratch;
+
+        // noise shrinks as 1/sqrt(spp), so does the colour tolerance
+        float sigmaC = colorSigma * scale / std::sqrt(static_cast<float>(std::max(1, samplesPerPixel)));
+        for (int it = 0; it < iterations; ++it) {
+            const int step = 1 << it;
+            const float invColor = 1.0f / std::max(1e-6f, sigmaC * sigmaC);
+            pool.ParallelFor(height, 8, [&](int y0, int y1) {
+                for (int y = y0; y < y1; ++y) {
+                    FilterRow(*src, *dst, gbuf, y, step, invColor);
+                }
+            });
+            std::swap(src, dst);
+            sigmaC *= 0.5f;
+        }
+        if (src != &color) {
+            color.swap(scratch);
+        }
+    }
+
+private:
+    std::vector<float> scratch;
+
+    void FilterRow(const std::vector<float>& in, std::vector<float>& out, const GBuffer& gbuf,
+                   int y, int step, float invColor) const {
+        static const float kernel[5] = {1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+        const int width = gbuf.width;
+        const int height = gbuf.height;
+        const float invNormal = 1.0f / (normalSigma * normalSigma);
+
+        for (int x = 0; x < width; ++x) {
+            const size_t p = static_cast<size_t>(y) * width + x;
+            const float* cp = &in[p * 3];
+            const GBufferSample& gP = gbuf.samples[p];
+            const int idP = gP.objectId;
+            const Vec3& nP = gP.normal;
+            const float zP = gP.depth;
+            const float invDepth = 1.0f / std::max(1e-4f, depthSigma * zP);
+
+            float sum[3] = {0.0f, 0.0f, 0.0f};
+            float wsum = 0.0f;
+            for (int ky = -2; ky <= 2; ++ky) {
+                const int qy = y + ky * step;
+                if (qy < 0 || qy >= height) continue;
+                for (int kx = -2; kx <= 2; ++kx) {
+                    const int qx = x + kx * step;
+                    if (qx < 0 || qx >= width) continue;
+                    const size_t q = static_cast<size_t>(qy) * width + qx;
+                    const GBufferSample& gQ = gbuf.samples[q];
+                    if (gQ.objectId != idP) continue;
+
+                    const float* cq = &in[q * 3];
+                    float dr = cq[0] - cp[0], dg = cq[1] - cp[1], db = cq[2] - cp[2];
+                    float w = kernel[kx + 2] * kernel[ky + 2];
+                    float e = (dr * dr + dg * dg + db * db) * invColor;
+                    if (idP >= 0) {
+                        e += (gQ.normal - nP).LengthSquared() * invNormal;
+                        e += std::fabs(gQ.depth - zP) * invDepth;
+                    }
+                    w *= std::exp(-e);
+                    sum[0] += cq[0] * w;
+                    sum[1] += cq[1] * w;
+                    sum[2] += cq[2] * w;
+                    wsum += w;
+                }
+            }
+
+            float* o = &out[p * 3];
+            const float inv = 1.0f / wsum;  // the centre tap always contributes
+            o[0] = sum[0] * inv;
+            o[1] = sum[1] * inv;
+            o[2] = sum[2] * inv;
+        }
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_DENOISER_HPP
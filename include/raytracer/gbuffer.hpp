@@ -0,0 +1,37 @@
+#ifndef RAYTRACER_GBUFFER_HPP
+#define RAYTRACER_GBUFFER_HPP
+
+#include <vector>
+#include "raytracer/vec3.hpp"
+
+namespace raytracer {
+
+// Attributes of the primary hit of one pixel.
+struct GBufferSample {
+    int objectId = -1;  // index into scene->objects, -1 for background
+    Vec3 normal;
+    float depth = 0.0f;
+};
+
+// Per-pixel primary hit attributes of the last rendered frame, used for
+// picking and as guides for post-process filters.
+struct GBuffer {
+    std::vector<GBufferSample> samples;
+    int width = 0;
+    int height = 0;
+
+    void Resize(int w, int h) {
+        width = w;
+        height = h;
+        samples.assign(static_cast<size_t>(w) * static_cast<size_t>(h), GBufferSample());
+    }
+
+    const GBufferSample* At(int x, int y) const {
+        if (x < 0 || y < 0 || x >= width || y >= height) return nullptr;
+        return &samples[static_cast<size_t>(y) * static_cast<size_t>(width) + static_cast<size_t>(x)];
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_GBUFFER_HPP
@@ -0,0 +1,44 @@
+#ifndef RAYTRACER_GLASS_HPP
+#define RAYTRACER_GLASS_HPP
+
+#include <cstring>
+#include <string>
+#include "raytracer/object.hpp"
+
+namespace raytracer {
+
+// Catalogue glass: index at the d line (587.6 nm) for the non-spectral
+// renderers and Sellmeier coefficients (wavelength in um) for the
+// spectral one.
+struct Glass {
+    const char* name;
+    float nd;
+    float b[3];
+    float c[3];
+};
+
+inline constexpr Glass kGlasses[] = {
+    {"N-BK7", 1.5168f, {1.03961212f, 0.231792344f, 1.01046945f}, {0.00600069867f, 0.0200179144f, 103.560653f}},
+    {"N-F2", 1.62004f, {1.39757037f, 0.159201403f, 1.2686543f}, {0.00995906143f, 0.0546931752f, 119.248346f}},
+    {"N-SF11", 1.78472f, {1.73759695f, 0.313747346f, 1.89878101f}, {0.013188707f, 0.0623068142f, 155.23629f}},
+    {"F_SILICA", 1.4585f, {0.6961663f, 0.4079426f, 0.8974794f}, {0.00467914826f, 0.0135120631f, 97.9340025f}},
+};
+
+// nullptr for unknown names.
+inline const Glass* FindGlass(const std::string& name) {
+    for (const Glass& glass : kGlasses) {
+        if (name == glass.name) return &glass;
+    }
+    return nullptr;
+}
+
+inline void ApplyGlass(Object& object, const Glass& glass) {
+    object.refractiveIndex = glass.nd;
+    object.dispersion.model = DispersionModel::Sellmeier;
+    std::memcpy(object.dispersion.b, glass.b, sizeof(glass.b));
+    std::memcpy(object.dispersion.c, glass.c, sizeof(glass.c));
+}
+
+} // namespace raytracer
+
+#endif // RAYTRACER_GLASS_HPP
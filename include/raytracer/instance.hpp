@@ -0,0 +1,119 @@
+#ifndef RAYTRACER_INSTANCE_HPP
+#define RAYTRACER_INSTANCE_HPP
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "raytracer/bvh.hpp"
+#include "raytracer/object.hpp"
+
+namespace raytracer {
+
+// Objects in a local frame with a BVH over them: a mesh, a lens or a whole
+// group. Immutable once built and shared by every Instance that shows it,
+// so an array of thousands of identical elements stores its geometry once.
+class InstanceGeometry {
+public:
+    explicit InstanceGeometry(std::vector<std::unique_ptr<Object>> objects_) : objects(std::move(objects_)) {
+        bvh.Build(objects);
+        if (!bvh.GetBounds(boundsMin, boundsMax)) boundsMin = boundsMax = Vec3(0, 0, 0);
+    }
+
+    const std::vector<std::unique_ptr<Object>>& Objects() const { return objects; }
+    bool IsBounded() const { return !bvh.HasUnbounded(); }
+
+    void GetBoundingBox(Vec3& min, Vec3& max) const {
+        min = boundsMin;
+        max = boundsMax;
+    }
+
+    // Closest hit in the local frame; object is the child that was hit.
+    template <typename T>
+    HitResultT<T> Intersect(const RayT<T>& ray) const {
+        HitResultT<T> closest;
+        closest.t = std::numeric_limits<T>::max();
+        bvh.Traverse(ray, closest.t, [&](uint32_t i) {
+            HitResultT<T> hit = objects[i]->Intersect(ray);
+            if (hit.hit && hit.t < closest.t && hit.t > HitEpsilon<T>()) closest = hit;
+            return false;
+        });
+        return closest;
+    }
+
+    bool ContainsPoint(const Vec3& point) const {
+        for (const auto& object : objects) {
+            if (object->ContainsPoint(point)) return true;
+        }
+        return false;
+    }
+
+    bool SolidContainsPoint(const Vec3& point) const {
+        for (const auto& object : objects) {
+            if (object->SolidContainsPoint(point)) return true;
+        }
+        return false;
+    }
+
+private:
+    std::vector<std::unique_ptr<Object>> objects;
+    ObjectBvh bvh;
+    Vec3 boundsMin;
+    Vec3 boundsMax;
+};
+
+// One placement of shared geometry: its own position, rotation, scale and
+// material (the Object fields), nothing else. Rays reach IntersectT already
+// rotated and scaled (ObjectImpl), so only the translation is left; the
+// scene BVH over instances and the geometry's own BVH form a two-level
+// structure.
+class Instance : public ObjectImpl<Instance> {
+public:
+    Instance(std::shared_ptr<const InstanceGeometry> geometry_ = nullptr, const std::string& name_ = "Instance")
+        : ObjectImpl(name_), geometry(std::move(geometry_)) {}
+
+    const std::shared_ptr<const InstanceGeometry>& GetGeometry() const { return geometry; }
+
+    template <typename T>
+    HitResultT<T> IntersectT(const RayT<T>& ray) const {
+        HitResultT<T> result;
+        if (!geometry) return result;
+        const RayT<T> local = RayT<T>::FromUnit(ray.origin - Vec3T<T>(position), ray.direction);
+        const HitResultT<T> hit = geometry->Intersect(local);
+        if (!hit.hit) return result;
+        result.hit = true;
+        result.t = hit.t;
+        result.point = ray.At(hit.t);
+        result.normal = hit.normal;
+        result.object = this;
+        return result;
+    }
+
+    void GetLocalBoundingBox(Vec3& min, Vec3& max) const override {
+        if (geometry) {
+            geometry->GetBoundingBox(min, max);
+        } else {
+            min = max = Vec3(0, 0, 0);
+        }
+        min += position;
+        max += position;
+    }
+
+    bool ContainsLocalPoint(const Vec3& point) const override {
+        return geometry && geometry->ContainsPoint(point - position);
+    }
+
+    bool SolidContainsLocalPoint(const Vec3& point) const override {
+        return geometry && geometry->SolidContainsPoint(point - position);
+    }
+
+    bool IsBounded() const override { return !geometry || geometry->IsBounded(); }
+
+private:
+    std::shared_ptr<const InstanceGeometry> geometry;
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_INSTANCE_HPP
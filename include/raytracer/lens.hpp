@@ -0,0 +1,335 @@
+#ifndef RAYTRACER_LENS_HPP
+#define RAYTRACER_LENS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include "raytracer/glass.hpp"
+#include "raytracer/object.hpp"
+#include "raytracer/simd.hpp"
+
+namespace raytracer {
+
+// Rotationally symmetric optical surface in the usual sag form
+//   z(s) = c s / (1 + sqrt(1 - (1 + k) c^2 s)) + A4 s^2 + A6 s^3 + A8 s^4 + A10 s^5
+// with s = r^2, measured from the vertex along +z.
+struct LensSurface {
+    float radius = 0.0f;                    // vertex radius, positive with the centre towards +z; 0 is flat
+    float conic = 0.0f;                     // k: 0 sphere, -1 paraboloid
+    float asphere[4] = {0.0f, 0.0f, 0.0f, 0.0f};  // A4, A6, A8, A10
+
+    float Curvature() const { return radius != 0.0f ? 1.0f / radius : 0.0f; }
+    bool IsAspheric() const { return asphere[0] != 0.0f || asphere[1] != 0.0f || asphere[2] != 0.0f || asphere[3] != 0.0f; }
+
+    // Largest s inside the conic's domain (infinite when it has none).
+    float MaxS() const {
+        const float c = Curvature();
+        const float k1c2 = (1.0f + conic) * c * c;
+        return k1c2 > 0.0f ? 1.0f / k1c2 : std::numeric_limits<float>::infinity();
+    }
+
+    template <typename T>
+    T Sag(T s) const {
+        const T c = T(Curvature());
+        const T q = std::sqrt(std::max(T(0), T(1) - T(1.0f + conic) * c * c * s));
+        return c * s / (T(1) + q) +
+               s * s * (T(asphere[0]) + s * (T(asphere[1]) + s * (T(asphere[2]) + s * T(asphere[3]))));
+    }
+};
+
+// Singlet lens along the local z axis, centred on the position: front
+// vertex at -thickness / 2, back vertex at +thickness / 2, cut to the clear
+// aperture by a cylindrical edge. Material is the glass (refractive index
+// and Sellmeier dispersion of the Object).
+//
+// Spherical and conic surfaces are intersected analytically. Aspheric ones
+// start from the roots of their base conic and refine them with Newton's
+// method on the sag equation; the four candidate roots (two per surface)
+// sit in the lanes of a Float4 and are refined together, a few steps from
+// that start.
+class Lens : public ObjectImpl<Lens> {
+public:
+    explicit Lens(const LensSurface& front_ = LensSurface{3.0f}, const LensSurface& back_ = LensSurface{-3.0f},
+                  float thickness_ = 0.5f, float clearAperture_ = 2.0f, const std::string& name_ = "Lens")
+        : ObjectImpl(name_) {
+        SetShape(front_, back_, thickness_, clearAperture_);
+        SetGlass("N-BK7");
+    }
+
+    const LensSurface& Front() const { return surfaces[0]; }
+    const LensSurface& Back() const { return surfaces[1]; }
+    float Thickness() const { return thickness; }
+    float ClearAperture() const { return 2.0f * semiAperture; }  // diameter
+    const std::string& GlassName() const { return glassName; }
+
+    // The aperture is clipped to the surfaces' domain and the centre
+    // thickness raised until the edge thickness is not negative.
+    void SetShape(const LensSurface& front_, const LensSurface& back_, float thickness_, float clearAperture_) {
+        surfaces[0] = front_;
+        surfaces[1] = back_;
+        const float maxS = std::min(surfaces[0].MaxS(), surfaces[1].MaxS());
+        semiAperture = std::max(0.01f, std::min(0.5f * clearAperture_, 0.999f * std::sqrt(maxS)));
+        const float s2 = semiAperture * semiAperture;
+        float minThickness = 0.0f;
+        for (int i = 0; i <= kProfileSamples; ++i) {
+            const float s = s2 * static_cast<float>(i) / kProfileSamples;
+            minThickness = std::max(minThickness, surfaces[0].Sag(s) - surfaces[1].Sag(s));
+        }
+        thickness = std::max(thickness_, minThickness + 1e-3f);
+        Rebuild();
+    }
+
+    // Unknown names leave the material unchanged and return false.
+    bool SetGlass(const std::string& name) {
+        const Glass* glass = FindGlass(name);
+        if (!glass) return false;
+        ApplyGlass(*this, *glass);
+        glassName = glass->name;
+        return true;
+    }
+
+    template <typename T>
+    HitResultT<T> IntersectT(const RayT<T>& ray) const {
+        HitResultT<T> result;
+        const RayT<T> local = RayT<T>::FromUnit(ray.origin - Vec3T<T>(position), ray.direction);
+        if (!HitsBox(local)) return result;
+
+        T t = std::numeric_limits<T>::max();
+        const int lane = IntersectSurfaces(local, t);
+        Vec3T<T> normal;
+        if (lane >= 0) {
+            const Vec3T<T> p = local.At(t);
+            const LensSurface& surface = surfaces[lane / 2];
+            const T slope = SagSlope<T>(surface, p.x * p.x + p.y * p.y);
+            normal = Vec3T<T>(T(-2) * slope * p.x, T(-2) * slope * p.y, T(1)).Normalized();
+            if (lane < 2) normal = -normal;
+        }
+        if (IntersectEdge(local, t, normal) || lane >= 0) {
+            result.hit = true;
+            result.t = t;
+            result.point = ray.At(t);
+            result.normal = normal;
+            result.object = this;
+        }
+        return result;
+    }
+
+    void GetLocalBoundingBox(Vec3& min, Vec3& max) const override {
+        min = position + boxMin;
+        max = position + boxMax;
+    }
+
+    bool ContainsLocalPoint(const Vec3& point) const override {
+        const Vec3 p = point - position;
+        const float s = p.x * p.x + p.y * p.y;
+        if (s > semiAperture * semiAperture) return false;
+        return p.z >= vertexZ[0] + surfaces[0].Sag(s) && p.z <= vertexZ[1] + surfaces[1].Sag(s);
+    }
+
+private:
+    static constexpr int kProfileSamples = 16;
+    static constexpr int kNewtonSteps = 6;
+
+    LensSurface surfaces[2];
+    float thickness = 0.5f;
+    float semiAperture = 1.0f;
+    std::string glassName;
+    float vertexZ[2] = {0.0f, 0.0f};
+    float edgeZ[2] = {0.0f, 0.0f};  // z of each surface at the rim
+    Vec3 boxMin, boxMax;
+    bool aspheric = false;
+    // per lane: front, front, back, back
+    alignas(16) float laneZ[4], laneC[4], laneK1[4], laneA4[4], laneA6[4], laneA8[4], laneA10[4];
+
+    void Rebuild() {
+        vertexZ[0] = -0.5f * thickness;
+        vertexZ[1] = 0.5f * thickness;
+        const float s2 = semiAperture * semiAperture;
+        float zMin = std::numeric_limits<float>::max(), zMax = -zMin;
+        for (int i = 0; i <= kProfileSamples; ++i) {
+            const float s = s2 * static_cast<float>(i) / kProfileSamples;
+            zMin = std::min(zMin, vertexZ[0] + surfaces[0].Sag(s));
+            zMax = std::max(zMax, vertexZ[1] + surfaces[1].Sag(s));
+        }
+        boxMin = Vec3(-semiAperture, -semiAperture, zMin);
+        boxMax = Vec3(semiAperture, semiAperture, zMax);
+        for (int i = 0; i < 2; ++i) edgeZ[i] = vertexZ[i] + surfaces[i].Sag(s2);
+
+        aspheric = surfaces[0].IsAspheric() || surfaces[1].IsAspheric();
+        for (int lane = 0; lane < 4; ++lane) {
+            const LensSurface& surface = surfaces[lane / 2];
+            laneZ[lane] = vertexZ[lane / 2];
+            laneC[lane] = surface.Curvature();
+            laneK1[lane] = 1.0f + surface.conic;
+            laneA4[lane] = surface.asphere[0];
+            laneA6[lane] = surface.asphere[1];
+            laneA8[lane] = surface.asphere[2];
+            laneA10[lane] = surface.asphere[3];
+        }
+    }
+
+    // d sag / ds
+    template <typename T>
+    static T SagSlope(const LensSurface& surface, T s) {
+        const T c = T(surface.Curvature());
+        const T q = std::sqrt(std::max(T(0), T(1) - T(1.0f + surface.conic) * c * c * s));
+        const float* a = surface.asphere;
+        return c / (T(2) * std::max(q, T(1e-6))) +
+               s * (T(2 * a[0]) + s * (T(3 * a[1]) + s * (T(4 * a[2]) + s * T(5 * a[3]))));
+    }
+
+    template <typename T>
+    bool HitsBox(const RayT<T>& ray) const {
+        const T lo[3] = {T(boxMin.x), T(boxMin.y), T(boxMin.z)};
+        const T hi[3] = {T(boxMax.x), T(boxMax.y), T(boxMax.z)};
+        const T o[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+        const T d[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+        T t0 = T(0), t1 = std::numeric_limits<T>::max();
+        for (int a = 0; a < 3; ++a) {
+            const T inv = T(1) / d[a];
+            T tn = (lo[a] - o[a]) * inv;
+            T tf = (hi[a] - o[a]) * inv;
+            if (tn > tf) std::swap(tn, tf);
+            t0 = tn > t0 ? tn : t0;
+            t1 = tf < t1 ? tf : t1;
+        }
+        return t0 <= t1;
+    }
+
+    // Cylindrical rim between the two surfaces.
+    template <typename T>
+    bool IntersectEdge(const RayT<T>& ray, T& t, Vec3T<T>& normal) const {
+        const T a = ray.direction.x * ray.direction.x + ray.direction.y * ray.direction.y;
+        if (a <= T(0)) return false;
+        const T b = T(2) * (ray.origin.x * ray.direction.x + ray.origin.y * ray.direction.y);
+        const T c = ray.origin.x * ray.origin.x + ray.origin.y * ray.origin.y - T(semiAperture) * T(semiAperture);
+        const T disc = b * b - T(4) * a * c;
+        if (disc < T(0)) return false;
+        const T root = std::sqrt(disc);
+        const T q = T(-0.5) * (b < T(0) ? b - root : b + root);
+        const T roots[2] = {std::min(q / a, c / q), std::max(q / a, c / q)};
+        for (T r : roots) {
+            if (!(r > HitEpsilon<T>() && r < t)) continue;
+            const Vec3T<T> p = ray.At(r);
+            if (p.z < T(edgeZ[0]) || p.z > T(edgeZ[1])) continue;
+            t = r;
+            normal = Vec3T<T>(p.x, p.y, T(0)) / T(semiAperture);
+            return true;
+        }
+        return false;
+    }
+
+    // Nearest accepted root on either surface before t: lanes 0-1 front,
+    // 2-3 back. Returns the lane or -1.
+    template <typename T>
+    int IntersectSurfaces(const RayT<T>& ray, T& t) const {
+        if constexpr (std::is_same_v<T, float>) {
+            return IntersectSurfaces4(ray, t);
+        } else {
+            int best = -1;
+            const T s2 = T(semiAperture) * T(semiAperture);
+            for (int lane = 0; lane < 4; ++lane) {
+                const LensSurface& surface = surfaces[lane / 2];
+                const T c = T(laneC[lane]), k1 = T(laneK1[lane]);
+                const T ow = ray.origin.z - T(laneZ[lane]);
+                // c (x^2 + y^2) + c (1 + k) w^2 - 2 w = 0 along the ray
+                const T A = c * (ray.direction.x * ray.direction.x + ray.direction.y * ray.direction.y) +
+                            c * k1 * ray.direction.z * ray.direction.z;
+                const T B = T(2) * c * (ray.origin.x * ray.direction.x + ray.origin.y * ray.direction.y) +
+                            T(2) * c * k1 * ow * ray.direction.z - T(2) * ray.direction.z;
+                const T C = c * (ray.origin.x * ray.origin.x + ray.origin.y * ray.origin.y) + c * k1 * ow * ow - T(2) * ow;
+                const T disc = B * B - T(4) * A * C;
+                const T root = std::sqrt(std::max(disc, T(0)));
+                const T q = T(-0.5) * (B < T(0) ? B - root : B + root);
+                T r = lane % 2 == 0 ? q / A : C / q;
+                if (!(std::fabs(r) < T(1e30))) r = -ow / ray.direction.z;
+
+                Vec3T<T> p = ray.At(r);
+                T s = p.x * p.x + p.y * p.y;
+                T f = p.z - T(laneZ[lane]) - surface.Sag(s);
+                const T tol = T(1e-9) * (T(1) + std::fabs(p.z));
+                for (int step = 0; aspheric && step < kNewtonSteps && !(std::fabs(f) < tol); ++step) {
+                    const T fp = ray.direction.z - SagSlope<T>(surface, s) * T(2) * (p.x * ray.direction.x + p.y * ray.direction.y);
+                    r -= f / fp;
+                    p = ray.At(r);
+                    s = p.x * p.x + p.y * p.y;
+                    f = p.z - T(laneZ[lane]) - surface.Sag(s);
+                }
+                if (!(r > HitEpsilon<T>() && r < t)) continue;
+                if (s > s2 || T(1) - k1 * c * c * s < T(0)) continue;
+                if (!(std::fabs(f) < T(1e-7) * (T(1) + std::fabs(p.z)))) continue;
+                t = r;
+                best = lane;
+            }
+            return best;
+        }
+    }
+
+    int IntersectSurfaces4(const Ray& ray, float& t) const {
+        const Float4 ox(ray.origin.x), oy(ray.origin.y), oz(ray.origin.z);
+        const Float4 dx(ray.direction.x), dy(ray.direction.y), dz(ray.direction.z);
+        const Float4 z0 = Float4::Load(laneZ), c = Float4::Load(laneC), k1 = Float4::Load(laneK1);
+        const Float4 zero(0.0f), one(1.0f), two(2.0f);
+
+        // seeds: both roots of each base conic, the vertex plane where a
+        // root does not exist
+        const Float4 ow = oz - z0;
+        const Float4 A = c * (dx * dx + dy * dy) + c * k1 * dz * dz;
+        const Float4 B = two * c * (ox * dx + oy * dy) + two * c * k1 * ow * dz - two * dz;
+        const Float4 C = c * (ox * ox + oy * oy) + c * k1 * ow * ow - two * ow;
+        const Float4 disc = B * B - Float4(4.0f) * A * C;
+        const Float4 root = Sqrt(Max(disc, zero));
+        const Float4 q = Float4(-0.5f) * (B + Select(B < zero, zero - root, root));
+        const Float4 firstRoot = Float4(0.0f, 1.0f, 0.0f, 1.0f) < Float4(0.5f);
+        Float4 r = Select(firstRoot, q / A, C / q);
+        Float4 px = ox + r * dx, py = oy + r * dy, pz = oz + r * dz;
+        Float4 s = px * px + py * py;
+
+        Float4 reject;
+        if (!aspheric) {
+            // exact roots; keep the branch the sag formula describes,
+            // (1 + k) c w <= 1
+            reject = (disc < zero) | (k1 * c * (pz - z0) > one);
+        } else {
+            const Float4 big(1e30f);
+            r = Select((r < big) & (r > zero - big), r, zero - ow / dz);
+            const Float4 a4 = Float4::Load(laneA4), a6 = Float4::Load(laneA6);
+            const Float4 a8 = Float4::Load(laneA8), a10 = Float4::Load(laneA10);
+            const Float4 tol(1e-5f);
+            Float4 f;
+            for (int step = 0;; ++step) {
+                px = ox + r * dx;
+                py = oy + r * dy;
+                pz = oz + r * dz;
+                s = px * px + py * py;
+                const Float4 qs = Sqrt(Max(one - k1 * c * c * s, zero));
+                f = pz - z0 - c * s / (one + qs) - s * s * (a4 + s * (a6 + s * (a8 + s * a10)));
+                if (step == kNewtonSteps || !MoveMask((f > tol) | (f < zero - tol))) break;
+                const Float4 slope = c / (two * Max(qs, Float4(1e-6f))) +
+                                     s * (two * a4 + s * (Float4(3.0f) * a6 + s * (Float4(4.0f) * a8 + s * Float4(5.0f) * a10)));
+                r = r - f / (dz - slope * two * (px * dx + py * dy));
+            }
+            const Float4 limit = tol * (one + Max(pz, zero - pz));
+            reject = (f > limit) | (f < zero - limit);
+        }
+        reject = reject | (s > Float4(semiAperture * semiAperture)) | (one - k1 * c * c * s < zero);
+        const int mask = MoveMask((r > Float4(HitEpsilon<float>())) & (r < Float4(t))) & ~MoveMask(reject);
+        if (!mask) return -1;
+        alignas(16) float ts[4];
+        r.Store(ts);
+        int best = -1;
+        for (int lane = 0; lane < 4; ++lane) {
+            if ((mask >> lane) & 1 && ts[lane] < t) {
+                t = ts[lane];
+                best = lane;
+            }
+        }
+        return best;
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_LENS_HPP
@@ -0,0 +1,142 @@
+#ifndef RAYTRACER_LIGHT_TREE_HPP
+#define RAYTRACER_LIGHT_TREE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "raytracer/object.hpp"
+#include "raytracer/vec3.hpp"
+
+namespace raytracer {
+
+// Bounding hierarchy over light sources. A shading point walks it from the
+// root, picking a child in proportion to its estimated contribution, so one
+// light is chosen out of N in O(log N) with a known probability.
+class LightTree {
+public:
+    struct Node {
+        Vec3 min;
+        Vec3 max;
+        float power = 0.0f;
+        int left = -1;
+        int right = -1;
+        const Object* light = nullptr;
+    };
+
+    std::vector<Node> nodes;
+
+    void Build(const std::vector<const Object*>& lights) {
+        nodes.clear();
+        if (lights.empty()) return;
+        nodes.reserve(lights.size() * 2);
+        items.assign(lights.begin(), lights.end());
+        BuildRange(items, 0, items.size());
+    }
+
+    bool Empty() const { return nodes.empty(); }
+
+    // Picks a light for a point with normal n, u uniform in [0, 1). Returns
+    // nullptr when no light can reach the point; otherwise pdf is set to the
+    // probability of the returned light.
+    const Object* Sample(const Vec3& point, const Vec3& n, float u, float& pdf) const {
+        pdf = 0.0f;
+        if (nodes.empty()) return nullptr;
+
+        float prob = 1.0f;
+        int idx = 0;
+        while (!nodes[static_cast<size_t>(idx)].light) {
+            const Node& node = nodes[static_cast<size_t>(idx)];
+            float wl = Importance(nodes[static_cast<size_t>(node.left)], point, n);
+            float wr = Importance(nodes[static_cast<size_t>(node.right)], point, n);
+            float total = wl + wr;
+            if (total <= 0.0f) return nullptr;
+
+            float pl = wl / total;
+            if (u < pl) {
+                u = std::min(u / pl, 0.99999994f);
+                prob *= pl;
+                idx = node.left;
+            } else {
+                u = std::min((u - pl) / (1.0f - pl), 0.99999994f);
+                prob *= 1.0f - pl;
+                idx = node.right;
+            }
+        }
+
+        if (Importance(nodes[static_cast<size_t>(idx)], point, n) <= 0.0f) return nullptr;
+        pdf = prob;
+        return nodes[static_cast<size_t>(idx)].light;
+    }
+
+private:
+    std::vector<const Object*> items;  // build scratch, kept between frames
+
+    // Conservative estimate of what a cluster can deliver to the point: the
+    // renderer's distance falloff times the best cosine any light inside the
+    // cluster's bounding sphere could produce. Zero only if every light in the
+    // cluster is behind the surface, which keeps the estimator unbiased.
+    static float Importance(const Node& node, const Vec3& point, const Vec3& n) {
+        Vec3 center = (node.min + node.max) * 0.5f;
+        float radius = (node.max - node.min).Length() * 0.5f;
+        Vec3 toCenter = center - point;
+        float dist = toCenter.Length();
+
+        float cosBound = 1.0f;
+        if (dist > radius) {
+            float cosN = n.Dot(toCenter) / dist;
+            float sinB = radius / dist;
+            float cosB = std::sqrt(std::max(0.0f, 1.0f - sinB * sinB));
+            float sinN = std::sqrt(std::max(0.0f, 1.0f - cosN * cosN));
+            // cos(thetaN - thetaB), clamped to zero past the horizon
+            if (cosN < cosB) {
+                cosBound = std::max(0.0f, cosN * cosB + sinN * sinB);
+            }
+        }
+
+        float d = std::max(dist, radius * 0.5f);
+        return node.power * cosBound / (1.0f + 0.02f * d);
+    }
+
+    int BuildRange(std::vector<const Object*>& items, size_t begin, size_t end) {
+        int idx = static_cast<int>(nodes.size());
+        nodes.emplace_back();
+
+        Vec3 bmin = items[begin]->position;
+        Vec3 bmax = bmin;
+        for (size_t i = begin; i < end; ++i) {
+            Vec3 lo, hi;
+            items[i]->GetBoundingBox(lo, hi);
+            bmin = Vec3(std::min(bmin.x, lo.x), std::min(bmin.y, lo.y), std::min(bmin.z, lo.z));
+            bmax = Vec3(std::max(bmax.x, hi.x), std::max(bmax.y, hi.y), std::max(bmax.z, hi.z));
+        }
+        nodes[static_cast<size_t>(idx)].min = bmin;
+        nodes[static_cast<size_t>(idx)].max = bmax;
+        nodes[static_cast<size_t>(idx)].power = static_cast<float>(end - begin);
+
+        if (end - begin == 1) {
+            nodes[static_cast<size_t>(idx)].light = items[begin];
+            return idx;
+        }
+
+        Vec3 extent = bmax - bmin;
+        int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+        size_t mid = begin + (end - begin) / 2;
+        std::nth_element(items.begin() + static_cast<long>(begin), items.begin() + static_cast<long>(mid),
+                         items.begin() + static_cast<long>(end),
+                         [axis](const Object* a, const Object* b) {
+                             const Vec3& pa = a->position;
+                             const Vec3& pb = b->position;
+                             return axis == 0 ? pa.x < pb.x : (axis == 1 ? pa.y < pb.y : pa.z < pb.z);
+                         });
+
+        int left = BuildRange(items, begin, mid);
+        int right = BuildRange(items, mid, end);
+        nodes[static_cast<size_t>(idx)].left = left;
+        nodes[static_cast<size_t>(idx)].right = right;
+        return idx;
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_LIGHT_TREE_HPP
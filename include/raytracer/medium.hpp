@@ -0,0 +1,70 @@
+#ifndef RAYTRACER_MEDIUM_HPP
+#define RAYTRACER_MEDIUM_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include "raytracer/simd.hpp"
+#include "raytracer/texture.hpp"
+#include "raytracer/vec3.hpp"
+#include "dr4/math/color.hpp"
+
+namespace raytracer {
+
+enum class MediumKind : uint8_t {
+    None,
+    Homogeneous,    // constant density: analytic transmittance
+    Heterogeneous,  // density scaled by `pattern`: adaptive ray marching
+};
+
+inline const char* MediumKindName(MediumKind kind) {
+    switch (kind) {
+        case MediumKind::None: return "none";
+        case MediumKind::Homogeneous: return "homogeneous";
+        case MediumKind::Heterogeneous: return "heterogeneous";
+    }
+    return "none";
+}
+
+// Inverse of MediumKindName; false for unknown names.
+inline bool ParseMediumKind(const std::string& name, MediumKind& kind) {
+    for (MediumKind k : {MediumKind::None, MediumKind::Homogeneous, MediumKind::Heterogeneous}) {
+        if (name == MediumKindName(k)) {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Henyey-Greenstein phase function, normalised over the sphere; cosTheta is
+// between the light's direction of travel and the scattered direction, g > 0
+// scatters forward.
+inline float PhaseHG(float cosTheta, float g) {
+    const float denom = std::max(1e-6f, 1.0f + g * g - 2.0f * g * cosTheta);
+    return 0.07957747f * (1.0f - g * g) / (denom * std::sqrt(denom));
+}
+
+// Scattering medium filling an object (Object::medium) or the whole scene
+// (Scene::medium). Extinction is grey; `color` tints the scattered light.
+struct Medium {
+    MediumKind kind = MediumKind::None;
+    float density = 0.1f;     // extinction per unit length (the peak for heterogeneous media)
+    float albedo = 0.9f;      // scattered share of the extinction
+    float anisotropy = 0.0f;  // Henyey-Greenstein g
+    dr4::Color color = dr4::Color(255, 255, 255);
+    float extent = 100.0f;    // rays are integrated at most this far from their origin
+    Texture pattern = Texture{TextureKind::Noise};  // density weight of heterogeneous media
+
+    // Extinction at a point in the medium's frame (the owner's local frame,
+    // world space for the scene medium).
+    float DensityAt(const Vec3& p) const {
+        if (kind != MediumKind::Heterogeneous) return density;
+        return density * pattern.Pattern(Vec3x4(p), Vec3x4(Vec3(0, 0, 0)))[0];
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_MEDIUM_HPP
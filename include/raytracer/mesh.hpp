@@ -0,0 +1,270 @@
+#ifndef RAYTRACER_MESH_HPP
+#define RAYTRACER_MESH_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "raytracer/bvh.hpp"
+#include "raytracer/object.hpp"
+#include "raytracer/simd.hpp"
+
+namespace raytracer {
+
+// Immutable triangle geometry with its own BVH. Triangles are stored in
+// leaf order, so a leaf reads a contiguous run of indices. Shared between
+// every Mesh object that shows it.
+class MeshData {
+public:
+    std::vector<float> positions;   // x, y, z per vertex
+    std::vector<uint32_t> indices;  // three vertices per triangle
+    std::vector<BvhNode> nodes;
+    Vec3 boundsMin;
+    Vec3 boundsMax;
+
+    size_t VertexCount() const { return positions.size() / 3; }
+    size_t TriangleCount() const { return indices.size() / 3; }
+    size_t MemoryBytes() const {
+        return positions.size() * sizeof(float) + indices.size() * sizeof(uint32_t) +
+               nodes.size() * sizeof(BvhNode);
+    }
+
+    // Binned-SAH build over positions/indices; reorders indices. Defined in
+    // src/raytracer/mesh.cpp.
+    void BuildBvh();
+
+    // Closest triangle hit with HitEpsilon < t < tHit. On a hit updates tHit
+    // and triangle and returns true.
+    template <typename T>
+    bool Intersect(const RayT<T>& ray, T& tHit, uint32_t& triangle) const;
+
+    // Number of surface crossings along the ray, for inside tests.
+    int CountCrossings(const Ray& ray) const;
+
+    template <typename T>
+    Vec3T<T> Normal(uint32_t triangle) const {
+        const Vec3T<T> a = Vertex<T>(indices[triangle * 3]);
+        const Vec3T<T> b = Vertex<T>(indices[triangle * 3 + 1]);
+        const Vec3T<T> c = Vertex<T>(indices[triangle * 3 + 2]);
+        return (b - a).Cross(c - a).Normalized();
+    }
+
+private:
+    template <typename T>
+    Vec3T<T> Vertex(uint32_t v) const {
+        const float* p = &positions[static_cast<size_t>(v) * 3];
+        return Vec3T<T>(p[0], p[1], p[2]);
+    }
+
+    // Ray set up for the watertight test of Woop, Benthin and Wald (2013):
+    // the ray is sheared onto +z, so neighbouring triangles share their edge
+    // functions exactly and rays cannot slip through shared edges.
+    template <typename T>
+    struct WatertightRay {
+        T org[3];
+        int kx, ky, kz;
+        T sx, sy, sz;
+
+        explicit WatertightRay(const RayT<T>& ray) {
+            const T d[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+            org[0] = ray.origin.x;
+            org[1] = ray.origin.y;
+            org[2] = ray.origin.z;
+            kz = std::fabs(d[0]) > std::fabs(d[1]) ? (std::fabs(d[0]) > std::fabs(d[2]) ? 0 : 2)
+                                                   : (std::fabs(d[1]) > std::fabs(d[2]) ? 1 : 2);
+            kx = (kz + 1) % 3;
+            ky = (kx + 1) % 3;
+            if (d[kz] < T(0)) std::swap(kx, ky);
+            sx = d[kx] / d[kz];
+            sy = d[ky] / d[kz];
+            sz = T(1) / d[kz];
+        }
+    };
+
+    template <typename T>
+    bool IntersectTriangle(const WatertightRay<T>& wr, uint32_t tri, T& tHit) const {
+        const float* v[3] = {&positions[static_cast<size_t>(indices[tri * 3]) * 3],
+                             &positions[static_cast<size_t>(indices[tri * 3 + 1]) * 3],
+                             &positions[static_cast<size_t>(indices[tri * 3 + 2]) * 3]};
+        T px[3], py[3], pz[3];
+        for (int i = 0; i < 3; ++i) {
+            const T ax = T(v[i][wr.kx]) - wr.org[wr.kx];
+            const T ay = T(v[i][wr.ky]) - wr.org[wr.ky];
+            const T az = T(v[i][wr.kz]) - wr.org[wr.kz];
+            px[i] = ax - wr.sx * az;
+            py[i] = ay - wr.sy * az;
+            pz[i] = wr.sz * az;
+        }
+        const T u = px[2] * py[1] - py[2] * px[1];
+        const T w = px[1] * py[0] - py[1] * px[0];
+        const T vv = px[0] * py[2] - py[0] * px[2];
+        if ((u < 0 || vv < 0 || w < 0) && (u > 0 || vv > 0 || w > 0)) return false;
+        const T det = u + vv + w;
+        if (det == T(0)) return false;
+        const T t = (u * pz[0] + vv * pz[1] + w * pz[2]) / det;
+        if (t <= HitEpsilon<T>() || t >= tHit) return false;
+        tHit = t;
+        return true;
+    }
+
+    // Four triangles of a leaf against one ray, one triangle per lane.
+    int IntersectTriangles4(const WatertightRay<float>& wr, uint32_t first, uint32_t count, float& tHit) const {
+        alignas(16) float coord[3][3][4];  // [vertex][kx, ky, kz][lane]
+        for (uint32_t lane = 0; lane < 4; ++lane) {
+            const uint32_t tri = first + std::min(lane, count - 1);
+            for (int i = 0; i < 3; ++i) {
+                const float* p = &positions[static_cast<size_t>(indices[tri * 3 + static_cast<uint32_t>(i)]) * 3];
+                coord[i][0][lane] = p[wr.kx] - wr.org[wr.kx];
+                coord[i][1][lane] = p[wr.ky] - wr.org[wr.ky];
+                coord[i][2][lane] = p[wr.kz] - wr.org[wr.kz];
+            }
+        }
+        const Float4 sx(wr.sx), sy(wr.sy), sz(wr.sz), zero(0.0f);
+        Float4 px[3], py[3], pz[3];
+        for (int i = 0; i < 3; ++i) {
+            const Float4 az = Float4::Load(coord[i][2]);
+            px[i] = Float4::Load(coord[i][0]) - sx * az;
+            py[i] = Float4::Load(coord[i][1]) - sy * az;
+            pz[i] = sz * az;
+        }
+        const Float4 u = px[2] * py[1] - py[2] * px[1];
+        const Float4 vv = px[0] * py[2] - py[0] * px[2];
+        const Float4 w = px[1] * py[0] - py[1] * px[0];
+        const Float4 anyNeg = (u < zero) | (vv < zero) | (w < zero);
+        const Float4 anyPos = (u > zero) | (vv > zero) | (w > zero);
+        const Float4 det = u + vv + w;
+        const Float4 t = (u * pz[0] + vv * pz[1] + w * pz[2]) / det;
+        // NaN from det == 0 fails both comparisons below
+        const Float4 inRange = (t > Float4(HitEpsilon<float>())) & (t < Float4(tHit));
+        const int mask = MoveMask(inRange) & ~MoveMask(anyNeg & anyPos) & ((1 << count) - 1);
+        if (!mask) return -1;
+        alignas(16) float ts[4];
+        t.Store(ts);
+        int best = -1;
+        for (int lane = 0; lane < 4; ++lane) {
+            if ((mask >> lane) & 1 && ts[lane] < tHit) {
+                tHit = ts[lane];
+                best = lane;
+            }
+        }
+        return best;
+    }
+};
+
+template <typename T>
+bool MeshData::Intersect(const RayT<T>& ray, T& tHit, uint32_t& triangle) const {
+    if (nodes.empty()) return false;
+    const WatertightRay<T> wr(ray);
+    const T inv[3] = {T(1) / ray.direction.x, T(1) / ray.direction.y, T(1) / ray.direction.z};
+    bool found = false;
+
+    uint32_t stack[64];
+    int sp = 0;
+    T tEnter;
+    if (!BvhSlabTest(nodes[0], wr.org, inv, tHit, tEnter)) return false;
+    uint32_t current = 0;
+    while (true) {
+        const BvhNode& node = nodes[current];
+        if (node.count > 0) {
+            for (uint32_t i = 0; i < node.count; i += 4) {
+                const uint32_t n = std::min(4u, node.count - i);
+                if constexpr (std::is_same_v<T, float>) {
+                    const int lane = IntersectTriangles4(wr, node.leftOrFirst + i, n, tHit);
+                    if (lane >= 0) {
+                        triangle = node.leftOrFirst + i + static_cast<uint32_t>(lane);
+                        found = true;
+                    }
+                } else {
+                    for (uint32_t k = 0; k < n; ++k) {
+                        if (IntersectTriangle(wr, node.leftOrFirst + i + k, tHit)) {
+                            triangle = node.leftOrFirst + i + k;
+                            found = true;
+                        }
+                    }
+                }
+            }
+        } else {
+            const uint32_t left = node.leftOrFirst;
+            T tl, tr;
+            const bool hitL = BvhSlabTest(nodes[left], wr.org, inv, tHit, tl);
+            const bool hitR = BvhSlabTest(nodes[left + 1], wr.org, inv, tHit, tr);
+            if (hitL && hitR) {
+                // nearer child first, the other one waits on the stack
+                const bool leftFirst = tl <= tr;
+                if (sp < 64) stack[sp++] = leftFirst ? left + 1 : left;
+                current = leftFirst ? left : left + 1;
+                continue;
+            }
+            if (hitL || hitR) {
+                current = hitL ? left : left + 1;
+                continue;
+            }
+        }
+        if (sp == 0) break;
+        current = stack[--sp];
+    }
+    return found;
+}
+
+// Triangle mesh loaded from binary STL or OBJ. The geometry is shared, so
+// copies of a mesh cost one pointer. Normals are per face.
+class Mesh : public ObjectImpl<Mesh> {
+public:
+    std::shared_ptr<const MeshData> data;
+    std::string sourcePath;
+
+    Mesh(std::shared_ptr<const MeshData> data_ = nullptr, const std::string& name_ = "Mesh")
+        : ObjectImpl(name_), data(std::move(data_)) {}
+
+    template <typename T>
+    HitResultT<T> IntersectT(const RayT<T>& ray) const {
+        HitResultT<T> result;
+        if (!data) return result;
+        const Vec3T<T> offset(position);
+        const RayT<T> local = RayT<T>::FromUnit(ray.origin - offset, ray.direction);
+        T t = std::numeric_limits<T>::max();
+        uint32_t triangle = 0;
+        if (!data->Intersect(local, t, triangle)) return result;
+        result.hit = true;
+        result.t = t;
+        result.point = ray.At(t);
+        result.normal = data->Normal<T>(triangle);
+        result.object = this;
+        return result;
+    }
+
+    void GetLocalBoundingBox(Vec3& min, Vec3& max) const override {
+        if (!data) {
+            min = max = position;
+            return;
+        }
+        min = data->boundsMin + position;
+        max = data->boundsMax + position;
+    }
+
+    // Odd number of crossings means inside; assumes a closed mesh. The ray
+    // direction is skewed so it does not run along edges of axis-aligned grids.
+    bool ContainsLocalPoint(const Vec3& point) const override {
+        if (!data) return false;
+        Vec3 min, max;
+        GetLocalBoundingBox(min, max);
+        if (point.x < min.x || point.y < min.y || point.z < min.z || point.x > max.x || point.y > max.y ||
+            point.z > max.z) {
+            return false;
+        }
+        return (data->CountCrossings(Ray::FromUnit(point - position, Vec3(1.0f, 0.1234567f, 0.0765432f).Normalized())) & 1) != 0;
+    }
+};
+
+// Loads a binary STL or an OBJ file (by extension) through a memory
+// mapping and builds its BVH. Throws std::runtime_error on failure.
+std::shared_ptr<MeshData> LoadMesh(const std::string& path);
+
+} // namespace raytracer
+
+#endif // RAYTRACER_MESH_HPP
@@ -1,29 +1,64 @@
 #ifndef RAYTRACER_OBJECT_HPP
 #define RAYTRACER_OBJECT_HPP
 
+#include <algorithm>
+#include <cmath>
 #include <string>
+#include "raytracer/medium.hpp"
 #include "raytracer/ray.hpp"
+#include "raytracer/texture.hpp"
+#include "raytracer/transform.hpp"
 #include "raytracer/vec3.hpp"
 #include "dr4/math/color.hpp"
 
 namespace raytracer {
 
-struct HitResult {
+enum class DispersionModel {
+    None,       // refractiveIndex at every wavelength
+    Cauchy,     // refractiveIndex at 587.6 nm plus B / l^2 + C / l^4 (l in um)
+    Sellmeier,  // n^2 = 1 + sum Bi l^2 / (l^2 - Ci) (l in um)
+};
+
+struct Dispersion {
+    DispersionModel model = DispersionModel::None;
+    float b[3] = {0.0f, 0.0f, 0.0f};  // Cauchy B, C; Sellmeier B1..B3
+    float c[3] = {0.0f, 0.0f, 0.0f};  // Sellmeier C1..C3
+};
+
+template <typename T>
+struct HitResultT {
     bool hit = false;
-    float t = 0.0f;
-    Vec3 point;
-    Vec3 normal;
+    T t = 0;
+    Vec3T<T> point;
+    Vec3T<T> normal;
     const class Object* object = nullptr;
+
+    HitResultT() {}
+    template <typename U>
+    explicit HitResultT(const HitResultT<U>& o)
+        : hit(o.hit), t(static_cast<T>(o.t)), point(o.point), normal(o.normal), object(o.object) {}
 };
 
+using HitResult = HitResultT<float>;
+using HitResultD = HitResultT<double>;
+
+// Smallest hit distance accepted, so a ray does not hit the surface it
+// starts on. The double engine can afford a much tighter one.
+template <typename T> constexpr T HitEpsilon();
+template <> constexpr float HitEpsilon<float>() { return 0.001f; }
+template <> constexpr double HitEpsilon<double>() { return 1e-9; }
+
 class Object {
 public:
     std::string name;
     Vec3 position;
     dr4::Color color;
+    Texture texture;  // pattern between color and texture.color2
+    Medium medium;    // fills the inside; the surface itself is then not rendered
     float refractiveIndex = 1.0f;
     float reflectivity = 0.0f;
     bool isLightSource = false;
+    Dispersion dispersion;
 
     Object(const std::string& name_ = "Object")
         : name(name_), position(0, 0, 0), color(255, 255, 255) {}
@@ -31,8 +66,130 @@ public:
     virtual ~Object() = default;
 
     virtual HitResult Intersect(const Ray& ray) const = 0;
-    virtual void GetBoundingBox(Vec3& min, Vec3& max) const = 0;
-    virtual bool ContainsPoint(const Vec3& point) const = 0;
+    virtual HitResultD Intersect(const RayD& ray) const = 0;
+
+    // Box and inside test of the shape before rotation and scale, placed at
+    // position. Shapes implement these; callers use the world-space versions.
+    virtual void GetLocalBoundingBox(Vec3& min, Vec3& max) const = 0;
+    virtual bool ContainsLocalPoint(const Vec3& point) const = 0;
+    // Inside test of the shape as a solid, for CSG; differs from
+    // ContainsLocalPoint only for planes, which are then half spaces.
+    virtual bool SolidContainsLocalPoint(const Vec3& point) const { return ContainsLocalPoint(point); }
+
+    // World-space box. The rotated box is cached relative to the position and
+    // recomputed only when the transform or the shape's own box changes; the
+    // cache makes this unsafe to call from several threads at once.
+    void GetBoundingBox(Vec3& min, Vec3& max) const {
+        GetLocalBoundingBox(min, max);
+        if (transform.IsIdentity()) return;
+        const Vec3 lo = min - position;
+        const Vec3 hi = max - position;
+        if (!boundsCacheValid || !SameVec(lo, cachedShapeMin) || !SameVec(hi, cachedShapeMax)) {
+            transform.BoundsToWorld(lo, hi, cachedBoundsMin, cachedBoundsMax);
+            cachedShapeMin = lo;
+            cachedShapeMax = hi;
+            boundsCacheValid = true;
+        }
+        min = position + cachedBoundsMin;
+        max = position + cachedBoundsMax;
+    }
+
+    bool ContainsPoint(const Vec3& point) const {
+        if (transform.IsIdentity()) return ContainsLocalPoint(point);
+        return ContainsLocalPoint(position + transform.PointToLocal(point, position));
+    }
+
+    bool SolidContainsPoint(const Vec3& point) const {
+        if (transform.IsIdentity()) return SolidContainsLocalPoint(point);
+        return SolidContainsLocalPoint(position + transform.PointToLocal(point, position));
+    }
+
+    // Rotation (degrees about x, then y, then z) and scale about the position.
+    const Vec3& GetRotation() const { return transform.Rotation(); }
+    const Vec3& GetScale() const { return transform.Scale(); }
+    const Transform& GetTransform() const { return transform; }
+    void SetRotation(const Vec3& degrees) { SetTransform(degrees, transform.Scale()); }
+    void SetScale(const Vec3& scale) { SetTransform(transform.Rotation(), scale); }
+    void SetTransform(const Vec3& rotationDegrees, const Vec3& scale) {
+        transform.Set(rotationDegrees, scale);
+        boundsCacheValid = false;
+    }
+
+    // Refractive index at the given vacuum wavelength in nanometres.
+    float IndexAt(float wavelengthNm) const {
+        const float l = wavelengthNm * 1e-3f;
+        const float l2 = l * l;
+        switch (dispersion.model) {
+            case DispersionModel::None:
+                return refractiveIndex;
+            case DispersionModel::Cauchy: {
+                const float d2 = 0.5876f * 0.5876f;
+                return refractiveIndex + dispersion.b[0] * (1.0f / l2 - 1.0f / d2) +
+                       dispersion.b[1] * (1.0f / (l2 * l2) - 1.0f / (d2 * d2));
+            }
+            case DispersionModel::Sellmeier: {
+                float n2 = 1.0f;
+                for (int i = 0; i < 3; ++i) {
+                    n2 += dispersion.b[i] * l2 / (l2 - dispersion.c[i]);
+                }
+                return std::sqrt(std::max(1.0f, n2));
+            }
+        }
+        return refractiveIndex;
+    }
+
+    bool IsDispersive() const { return dispersion.model != DispersionModel::None; }
+
+    // Objects holding a medium only bound it: rays pass their surface.
+    bool IsVolume() const { return medium.kind != MediumKind::None; }
+
+    // False for objects that extend to infinity (planes); GetBoundingBox is
+    // then only a display hint and acceleration structures test them always.
+    virtual bool IsBounded() const { return true; }
+
+    // Radius used when the object is sampled as an area light; 0 means a point light.
+    virtual float GetEmitterRadius() const { return 0.0f; }
+
+protected:
+    Transform transform;
+
+private:
+    mutable bool boundsCacheValid = false;
+    mutable Vec3 cachedShapeMin, cachedShapeMax;
+    mutable Vec3 cachedBoundsMin, cachedBoundsMax;
+
+    static bool SameVec(const Vec3& a, const Vec3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+};
+
+// Implements both Intersect overloads from one Derived::IntersectT<T>
+// template, so every primitive is written once for float and double.
+// Rotated or scaled objects get the ray in object space (about the
+// position, so IntersectT sees the untransformed shape); the hit distance
+// and normal are mapped back to world space.
+template <typename Derived>
+class ObjectImpl : public Object {
+public:
+    using Object::Object;
+
+    HitResult Intersect(const Ray& ray) const override { return IntersectTransformed(ray); }
+    HitResultD Intersect(const RayD& ray) const override { return IntersectTransformed(ray); }
+
+private:
+    template <typename T>
+    HitResultT<T> IntersectTransformed(const RayT<T>& ray) const {
+        const Derived& shape = *static_cast<const Derived*>(this);
+        if (transform.IsIdentity()) return shape.template IntersectT<T>(ray);
+        T worldPerLocal;
+        RayT<T> local = transform.RayToLocal(ray, position, worldPerLocal);
+        local.origin += Vec3T<T>(position);
+        HitResultT<T> hit = shape.template IntersectT<T>(local);
+        if (hit.hit) {
+            hit.t *= worldPerLocal;
+            hit.point = ray.At(hit.t);
+            hit.normal = transform.NormalToWorld(hit.normal);
+        }
+        return hit;
+    }
 };
 
 } // namespace raytracer
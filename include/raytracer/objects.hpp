@@ -2,101 +2,118 @@
 #define RAYTRACER_OBJECTS_HPP
 
 #include "raytracer/object.hpp"
+#include "raytracer/simd.hpp"
 #include <cmath>
 #include <algorithm>
+#include <limits>
+#include <type_traits>
 
 namespace raytracer {
 
-class Sphere : public Object {
+class Sphere : public ObjectImpl<Sphere> {
 public:
     float radius;
 
     Sphere(float radius_ = 1.0f, const std::string& name_ = "Sphere")
-        : Object(name_), radius(radius_) {}
-
-    HitResult Intersect(const Ray& ray) const override {
-        HitResult result;
-        Vec3 oc = ray.origin - position;
-        float a = ray.direction.Dot(ray.direction);
-        float b = 2.0f * oc.Dot(ray.direction);
-        float c = oc.Dot(oc) - radius * radius;
-        float discriminant = b * b - 4 * a * c;
+        : ObjectImpl(name_), radius(radius_) {}
+
+    template <typename T>
+    HitResultT<T> IntersectT(const RayT<T>& ray) const {
+        HitResultT<T> result;
+        const Vec3T<T> center(position);
+        const T eps = HitEpsilon<T>();
+        Vec3T<T> oc = ray.origin - center;
+        T a = ray.direction.Dot(ray.direction);
+        T b = T(2) * oc.Dot(ray.direction);
+        T c = oc.Dot(oc) - T(radius) * T(radius);
+        T discriminant = b * b - 4 * a * c;
 
         if (discriminant < 0) {
             return result;
         }
 
-        float sqrt_d = sqrt(discriminant);
-        float t1 = (-b - sqrt_d) / (2.0f * a);
-        float t2 = (-b + sqrt_d) / (2.0f * a);
+        T sqrt_d = std::sqrt(discriminant);
+        T t1 = (-b - sqrt_d) / (T(2) * a);
+        T t2 = (-b + sqrt_d) / (T(2) * a);
 
-        float t = (t1 > 0.001f) ? t1 : ((t2 > 0.001f) ? t2 : -1.0f);
-        if (t > 0.001f) {
+        T t = (t1 > eps) ? t1 : ((t2 > eps) ? t2 : T(-1));
+        if (t > eps) {
             result.hit = true;
             result.t = t;
             result.point = ray.At(t);
-            result.normal = (result.point - position).Normalized();
+            result.normal = (result.point - center).Normalized();
             result.object = this;
         }
 
         return result;
     }
 
-    void GetBoundingBox(Vec3& min, Vec3& max) const override {
+    void GetLocalBoundingBox(Vec3& min, Vec3& max) const override {
         min = position - Vec3(radius, radius, radius);
         max = position + Vec3(radius, radius, radius);
     }
 
-    bool ContainsPoint(const Vec3& point) const override {
+    bool ContainsLocalPoint(const Vec3& point) const override {
         Vec3 diff = point - position;
         return diff.LengthSquared() <= radius * radius;
     }
+
+    float GetEmitterRadius() const override { return radius; }
 };
 
-class Plane : public Object {
+class Plane : public ObjectImpl<Plane> {
 public:
     Vec3 normal;
 
     Plane(const Vec3& normal_ = Vec3(0, 1, 0), const std::string& name_ = "Plane")
-        : Object(name_), normal(normal_.Normalized()) {}
+        : ObjectImpl(name_), normal(normal_.Normalized()) {}
 
-    HitResult Intersect(const Ray& ray) const override {
-        HitResult result;
-        float denom = normal.Dot(ray.direction);
+    template <typename T>
+    HitResultT<T> IntersectT(const RayT<T>& ray) const {
+        HitResultT<T> result;
+        const Vec3T<T> n(normal);
+        T denom = n.Dot(ray.direction);
         
-        if (fabs(denom) < 1e-6f) {
+        if (std::fabs(denom) < T(1e-6)) {
             return result;
         }
 
-        Vec3 p0l0 = position - ray.origin;
-        float t = p0l0.Dot(normal) / denom;
+        Vec3T<T> p0l0 = Vec3T<T>(position) - ray.origin;
+        T t = p0l0.Dot(n) / denom;
 
-        if (t > 0.001f) {
+        if (t > HitEpsilon<T>()) {
             result.hit = true;
             result.t = t;
             result.point = ray.At(t);
-            result.normal = normal;
+            result.normal = n;
             result.object = this;
         }
 
         return result;
     }
 
-    void GetBoundingBox(Vec3& min, Vec3& max) const override {
+    void GetLocalBoundingBox(Vec3& min, Vec3& max) const override {
         const float large = 1000.0f;
         min = Vec3(-large, -large, -large);
         max = Vec3(large, large, large);
     }
 
-    bool ContainsPoint(const Vec3& point) const override {
+    bool IsBounded() const override { return false; }
+
+    bool ContainsLocalPoint(const Vec3& point) const override {
         Vec3 diff = point - position;
         return fabs(diff.Dot(normal)) < 0.1f;
     }
+
+    // The half space behind the normal.
+    bool SolidContainsLocalPoint(const Vec3& point) const override {
+        return (point - position).Dot(normal) < 0.0f;
+    }
 };
 
 
 
-class RectPlane : public Object {
+class RectPlane : public ObjectImpl<RectPlane> {
 public:
     Vec3 normal;
     float width;
@@ -106,43 +123,46 @@ public:
               float height_ = 2.0f,
               const Vec3& normal_ = Vec3(0, 1, 0),
               const std::string& name_ = "RectPlane")
-        : Object(name_), normal(normal_.Normalized()), width(width_), height(height_) {}
-
-    HitResult Intersect(const Ray& ray) const override {
-        HitResult result;
-        float denom = normal.Dot(ray.direction);
-        if (fabs(denom) < 1e-6f) {
+        : ObjectImpl(name_), normal(normal_.Normalized()), width(width_), height(height_) {}
+
+    template <typename T>
+    HitResultT<T> IntersectT(const RayT<T>& ray) const {
+        HitResultT<T> result;
+        const Vec3T<T> n(normal);
+        const Vec3T<T> center(position);
+        T denom = n.Dot(ray.direction);
+        if (std::fabs(denom) < T(1e-6)) {
             return result;
         }
 
-        float t = (position - ray.origin).Dot(normal) / denom;
-        if (t <= 0.001f) {
+        T t = (center - ray.origin).Dot(n) / denom;
+        if (t <= HitEpsilon<T>()) {
             return result;
         }
 
-        Vec3 hitPoint = ray.At(t);
+        Vec3T<T> hitPoint = ray.At(t);
 
         
-        Vec3 ref = (fabs(normal.y) < 0.95f) ? Vec3(0, 1, 0) : Vec3(1, 0, 0);
-        Vec3 u = normal.Cross(ref).Normalized();
-        Vec3 v = u.Cross(normal).Normalized();
-
-        Vec3 d = hitPoint - position;
-        float du = d.Dot(u);
-        float dv = d.Dot(v);
-        if (fabs(du) > width * 0.5f || fabs(dv) > height * 0.5f) {
+        Vec3T<T> ref = (std::fabs(n.y) < T(0.95)) ? Vec3T<T>(0, 1, 0) : Vec3T<T>(1, 0, 0);
+        Vec3T<T> u = n.Cross(ref).Normalized();
+        Vec3T<T> v = u.Cross(n).Normalized();
+
+        Vec3T<T> d = hitPoint - center;
+        T du = d.Dot(u);
+        T dv = d.Dot(v);
+        if (std::fabs(du) > T(width) * T(0.5) || std::fabs(dv) > T(height) * T(0.5)) {
             return result;
         }
 
         result.hit = true;
         result.t = t;
         result.point = hitPoint;
-        result.normal = normal;
+        result.normal = n;
         result.object = this;
         return result;
     }
 
-    void GetBoundingBox(Vec3& min, Vec3& max) const override {
+    void GetLocalBoundingBox(Vec3& min, Vec3& max) const override {
         
         Vec3 ref = (fabs(normal.y) < 0.95f) ? Vec3(0, 1, 0) : Vec3(1, 0, 0);
         Vec3 u = normal.Cross(ref).Normalized();
@@ -172,7 +192,7 @@ public:
         max += Vec3(fabs(pad.x), fabs(pad.y), fabs(pad.z));
     }
 
-    bool ContainsPoint(const Vec3& point) const override {
+    bool ContainsLocalPoint(const Vec3& point) const override {
         Vec3 diff = point - position;
         if (fabs(diff.Dot(normal)) > 0.1f) return false;
 
@@ -186,35 +206,38 @@ public:
     }
 };
 
-class Disk : public Object {
+class Disk : public ObjectImpl<Disk> {
 public:
     Vec3 normal;
     float radius;
 
     Disk(float radius_ = 1.0f, const Vec3& normal_ = Vec3(0, 1, 0), const std::string& name_ = "Disk")
-        : Object(name_), normal(normal_.Normalized()), radius(radius_) {}
-
-    HitResult Intersect(const Ray& ray) const override {
-        HitResult result;
-        float denom = normal.Dot(ray.direction);
+        : ObjectImpl(name_), normal(normal_.Normalized()), radius(radius_) {}
+
+    template <typename T>
+    HitResultT<T> IntersectT(const RayT<T>& ray) const {
+        HitResultT<T> result;
+        const Vec3T<T> n(normal);
+        const Vec3T<T> center(position);
+        T denom = n.Dot(ray.direction);
         
-        if (fabs(denom) < 1e-6f) {
+        if (std::fabs(denom) < T(1e-6)) {
             return result;
         }
 
-        Vec3 p0l0 = position - ray.origin;
-        float t = p0l0.Dot(normal) / denom;
+        Vec3T<T> p0l0 = center - ray.origin;
+        T t = p0l0.Dot(n) / denom;
 
-        if (t > 0.001f) {
-            Vec3 hitPoint = ray.At(t);
-            Vec3 diff = hitPoint - position;
-            float distSq = diff.Dot(diff);
+        if (t > HitEpsilon<T>()) {
+            Vec3T<T> hitPoint = ray.At(t);
+            Vec3T<T> diff = hitPoint - center;
+            T distSq = diff.Dot(diff);
             
-            if (distSq <= radius * radius) {
+            if (distSq <= T(radius) * T(radius)) {
                 result.hit = true;
                 result.t = t;
                 result.point = hitPoint;
-                result.normal = normal;
+                result.normal = n;
                 result.object = this;
             }
         }
@@ -222,69 +245,77 @@ public:
         return result;
     }
 
-    void GetBoundingBox(Vec3& min, Vec3& max) const override {
+    void GetLocalBoundingBox(Vec3& min, Vec3& max) const override {
         min = position - Vec3(radius, radius, radius);
         max = position + Vec3(radius, radius, radius);
     }
 
-    bool ContainsPoint(const Vec3& point) const override {
+    bool ContainsLocalPoint(const Vec3& point) const override {
         Vec3 diff = point - position;
         if (fabs(diff.Dot(normal)) > 0.1f) return false;
         return diff.Dot(diff) <= radius * radius;
     }
 };
 
-class Prism : public Object {
+class Prism : public ObjectImpl<Prism> {
 public:
     Vec3 size;
 
     Prism(const Vec3& size_ = Vec3(1, 1, 1), const std::string& name_ = "Prism")
-        : Object(name_), size(size_) {}
-
-    HitResult Intersect(const Ray& ray) const override {
-        HitResult result;
-        Vec3 invDir = Vec3(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
-        Vec3 min = position - size * 0.5f;
-        Vec3 max = position + size * 0.5f;
-
-        float tmin = (min.x - ray.origin.x) * invDir.x;
-        float tmax = (max.x - ray.origin.x) * invDir.x;
-        if (invDir.x < 0) std::swap(tmin, tmax);
-
-        float tymin = (min.y - ray.origin.y) * invDir.y;
-        float tymax = (max.y - ray.origin.y) * invDir.y;
-        if (invDir.y < 0) std::swap(tymin, tymax);
-
-        if (tmin > tymax || tymin > tmax) return result;
-
-        if (tymin > tmin) tmin = tymin;
-        if (tymax < tmax) tmax = tymax;
-
-        float tzmin = (min.z - ray.origin.z) * invDir.z;
-        float tzmax = (max.z - ray.origin.z) * invDir.z;
-        if (invDir.z < 0) std::swap(tzmin, tzmax);
-
-        if (tmin > tzmax || tzmin > tmax) return result;
-
-        if (tzmin > tmin) tmin = tzmin;
-        if (tzmax < tmax) tmax = tzmax;
+        : ObjectImpl(name_), size(size_) {}
+
+    template <typename T>
+    HitResultT<T> IntersectT(const RayT<T>& ray) const {
+        HitResultT<T> result;
+        const Vec3T<T> min = Vec3T<T>(position) - Vec3T<T>(size) * T(0.5);
+        const Vec3T<T> max = Vec3T<T>(position) + Vec3T<T>(size) * T(0.5);
+
+        T tmin, tmax;
+        if constexpr (std::is_same_v<T, float>) {
+            // slab test on all three axes at once
+            const Vec4 origin(ray.origin);
+            const Vec4 invDir(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+            const Vec4 t0 = (Vec4(min) - origin) * invDir;
+            const Vec4 t1 = (Vec4(max) - origin) * invDir;
+            const Vec3 tNear = Min(t0, t1).ToVec3();
+            const Vec3 tFar = Max(t0, t1).ToVec3();
+            tmin = std::max(tNear.x, std::max(tNear.y, tNear.z));
+            tmax = std::min(tFar.x, std::min(tFar.y, tFar.z));
+        } else {
+            const T lo[3] = {min.x, min.y, min.z};
+            const T hi[3] = {max.x, max.y, max.z};
+            const T o[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+            const T d[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+            tmin = -std::numeric_limits<T>::infinity();
+            tmax = std::numeric_limits<T>::infinity();
+            for (int axis = 0; axis < 3; ++axis) {
+                T inv = T(1) / d[axis];
+                T t0 = (lo[axis] - o[axis]) * inv;
+                T t1 = (hi[axis] - o[axis]) * inv;
+                tmin = std::max(tmin, std::min(t0, t1));
+                tmax = std::min(tmax, std::max(t0, t1));
+            }
+        }
+        if (tmin > tmax) return result;
 
-        if (tmin > 0.001f) {
+        // from inside (refraction, CSG) the exit face is the hit
+        const T t = tmin > HitEpsilon<T>() ? tmin : tmax;
+        if (t > HitEpsilon<T>()) {
             result.hit = true;
-            result.t = tmin;
-            result.point = ray.At(tmin);
+            result.t = t;
+            result.point = ray.At(t);
+
+            Vec3T<T> center = (min + max) * T(0.5);
+            Vec3T<T> p = result.point - center;
+            // face by the largest coordinate relative to the half size
+            Vec3T<T> absP(std::fabs(p.x / T(size.x)), std::fabs(p.y / T(size.y)), std::fabs(p.z / T(size.z)));
 
-            Vec3 center = (min + max) * 0.5f;
-            Vec3 p = result.point - center;
-            Vec3 absP(fabs(p.x), fabs(p.y), fabs(p.z));
-            Vec3 halfSize = size * 0.5f;
-            
             if (absP.x >= absP.y && absP.x >= absP.z) {
-                result.normal = Vec3(p.x > 0 ? 1 : -1, 0, 0);
+                result.normal = Vec3T<T>(p.x > 0 ? 1 : -1, 0, 0);
             } else if (absP.y >= absP.x && absP.y >= absP.z) {
-                result.normal = Vec3(0, p.y > 0 ? 1 : -1, 0);
+                result.normal = Vec3T<T>(0, p.y > 0 ? 1 : -1, 0);
             } else {
-                result.normal = Vec3(0, 0, p.z > 0 ? 1 : -1);
+                result.normal = Vec3T<T>(0, 0, p.z > 0 ? 1 : -1);
             }
             result.object = this;
         }
@@ -292,12 +323,12 @@ public:
         return result;
     }
 
-    void GetBoundingBox(Vec3& min, Vec3& max) const override {
+    void GetLocalBoundingBox(Vec3& min, Vec3& max) const override {
         min = position - size * 0.5f;
         max = position + size * 0.5f;
     }
 
-    bool ContainsPoint(const Vec3& point) const override {
+    bool ContainsLocalPoint(const Vec3& point) const override {
         Vec3 halfSize = size * 0.5f;
         Vec3 diff = point - position;
         return fabs(diff.x) <= halfSize.x && 
@@ -306,80 +337,96 @@ public:
     }
 };
 
-class Pyramid : public Object {
+class Pyramid : public ObjectImpl<Pyramid> {
 public:
     float baseSize;
     float height;
 
     Pyramid(float baseSize_ = 1.0f, float height_ = 1.0f, const std::string& name_ = "Pyramid")
-        : Object(name_), baseSize(baseSize_), height(height_) {}
-
-    HitResult Intersect(const Ray& ray) const override {
-        HitResult result;
-
-        const float half = baseSize * 0.5f;
-        const float baseY = position.y - height * 0.5f;
-        const float apexY = position.y + height * 0.5f;
-
-        const Vec3 P(position.x, apexY, position.z);
-        const Vec3 A(position.x - half, baseY, position.z - half);
-        const Vec3 B(position.x + half, baseY, position.z - half);
-        const Vec3 C(position.x + half, baseY, position.z + half);
-        const Vec3 D(position.x - half, baseY, position.z + half);
-
-        const Vec3 inside(position.x, position.y, position.z);
-
-        struct PlaneEq { Vec3 n; float d; }; 
-        auto makePlane = [&](const Vec3& p0, const Vec3& p1, const Vec3& p2) -> PlaneEq {
-            Vec3 n = (p1 - p0).Cross(p2 - p0).Normalized();
-            float d = -n.Dot(p0);
-            float s = n.Dot(inside) + d;
-            if (s > 0.0f) { n = -n; d = -d; }
+        : ObjectImpl(name_), baseSize(baseSize_), height(height_) {}
+
+    template <typename T>
+    HitResultT<T> IntersectT(const RayT<T>& ray) const {
+        using V = Vec3T<T>;
+        HitResultT<T> result;
+
+        const T half = T(baseSize) * T(0.5);
+        const T baseY = T(position.y) - T(height) * T(0.5);
+        const T apexY = T(position.y) + T(height) * T(0.5);
+        const T px = position.x, pz = position.z;
+
+        const V P(px, apexY, pz);
+        const V A(px - half, baseY, pz - half);
+        const V B(px + half, baseY, pz - half);
+        const V C(px + half, baseY, pz + half);
+        const V D(px - half, baseY, pz + half);
+
+        const V inside(position);
+
+        struct PlaneEq { V n; T d; }; 
+        auto makePlane = [&](const V& p0, const V& p1, const V& p2) -> PlaneEq {
+            V n = (p1 - p0).Cross(p2 - p0).Normalized();
+            T d = -n.Dot(p0);
+            T s = n.Dot(inside) + d;
+            if (s > 0) { n = -n; d = -d; }
             return {n, d};
         };
 
         PlaneEq planes[5] = {
-            PlaneEq{Vec3(0, -1, 0), baseY},          
+            PlaneEq{V(0, -1, 0), baseY},          
             makePlane(P, B, A),                      
             makePlane(P, C, B),                      
             makePlane(P, D, C),                      
             makePlane(P, A, D)                       
         };
 
-        float tEnter = 0.001f;
-        float tExit = 1e30f;
-        Vec3 enterNormal(0, 1, 0);
+        T tEnter = HitEpsilon<T>();
+        T tExit = T(1e30);
+        V enterNormal(0, 1, 0);
+        V exitNormal(0, 1, 0);
+        bool entered = false;
 
         for (const auto& pl : planes) {
-            float denom = pl.n.Dot(ray.direction);
-            float dist = pl.n.Dot(ray.origin) + pl.d;
-            if (fabs(denom) < 1e-6f) {
-                if (dist > 0.0f) return result;
+            T denom = pl.n.Dot(ray.direction);
+            T dist = pl.n.Dot(ray.origin) + pl.d;
+            if (std::fabs(denom) < T(1e-6)) {
+                if (dist > 0) return result;
                 continue;
             }
-            float t = -dist / denom;
-            if (denom > 0.0f) {
-                tExit = std::min(tExit, t);
+            T t = -dist / denom;
+            if (denom > 0) {
+                if (t < tExit) {
+                    tExit = t;
+                    exitNormal = pl.n;
+                }
             } else {
                 if (t > tEnter) {
                     tEnter = t;
                     enterNormal = pl.n;
+                    entered = true;
                 }
             }
             if (tEnter > tExit) return result;
         }
 
-        if (tEnter > 0.001f) {
+        if (entered) {
             result.hit = true;
             result.t = tEnter;
             result.point = ray.At(tEnter);
             result.normal = enterNormal;
             result.object = this;
+        } else if (tExit < T(1e30)) {
+            // the origin is inside: leave through the nearest exit plane
+            result.hit = true;
+            result.t = tExit;
+            result.point = ray.At(tExit);
+            result.normal = exitNormal;
+            result.object = this;
         }
         return result;
     }
 
-    void GetBoundingBox(Vec3& min, Vec3& max) const override {
+    void GetLocalBoundingBox(Vec3& min, Vec3& max) const override {
         const float half = baseSize * 0.5f;
         const float baseY = position.y - height * 0.5f;
         const float apexY = position.y + height * 0.5f;
@@ -387,7 +434,7 @@ public:
         max = Vec3(position.x + half, apexY, position.z + half);
     }
 
-    bool ContainsPoint(const Vec3& point) const override {
+    bool ContainsLocalPoint(const Vec3& point) const override {
         const float half = baseSize * 0.5f;
         const float baseY = position.y - height * 0.5f;
         const float apexY = position.y + height * 0.5f;
@@ -0,0 +1,333 @@
+#ifndef RAYTRACER_PARALLEL_HPP
+#define RAYTRACER_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace raytracer {
+
+inline unsigned DefaultWorkerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+enum class AffinityPolicy {
+    None,     // let the OS schedule workers
+    Compact,  // worker i on the i-th allowed CPU
+    Scatter,  // workers spread evenly over the allowed CPUs (across sockets / NUMA nodes)
+};
+
+enum class ThreadPriority {
+    Normal,
+    Low,     // nice 10, the UI and other processes win
+    Lowest,  // nice 19
+};
+
+// How many render workers to run and where. The calling thread always
+// takes part in the work, so `threads` includes it and it is never pinned.
+struct ThreadConfig {
+    unsigned threads = 0;       // 0: hardware_concurrency() - reservedCores
+    unsigned reservedCores = 0; // cores left to the UI and other work when threads == 0
+    AffinityPolicy affinity = AffinityPolicy::None;
+    std::vector<int> cpus;      // CPUs workers may run on; empty means all allowed CPUs
+    ThreadPriority priority = ThreadPriority::Normal;
+
+    unsigned WorkerCount() const {
+        if (threads > 0) return threads;
+        const unsigned hw = DefaultWorkerCount();
+        return hw > reservedCores ? hw - reservedCores : 1u;
+    }
+
+    // Defaults overridden by MYZEMAX_RENDER_THREADS (count), MYZEMAX_RENDER_RESERVE
+    // (cores), MYZEMAX_RENDER_AFFINITY (none|compact|scatter), MYZEMAX_RENDER_CPUS
+    // (list such as "0-3,8") and MYZEMAX_RENDER_PRIORITY (normal|low|lowest).
+    static ThreadConfig FromEnvironment() {
+        ThreadConfig config;
+        if (const char* v = std::getenv("MYZEMAX_RENDER_THREADS")) {
+            config.threads = static_cast<unsigned>(std::max(0, std::atoi(v)));
+        }
+        if (const char* v = std::getenv("MYZEMAX_RENDER_RESERVE")) {
+            config.reservedCores = static_cast<unsigned>(std::max(0, std::atoi(v)));
+        }
+        if (const char* v = std::getenv("MYZEMAX_RENDER_AFFINITY")) {
+            std::string s(v);
+            if (s == "compact") config.affinity = AffinityPolicy::Compact;
+            else if (s == "scatter") config.affinity = AffinityPolicy::Scatter;
+            else config.affinity = AffinityPolicy::None;
+        }
+        if (const char* v = std::getenv("MYZEMAX_RENDER_CPUS")) {
+            config.cpus = ParseCpuList(v);
+        }
+        if (const char* v = std::getenv("MYZEMAX_RENDER_PRIORITY")) {
+            std::string s(v);
+            if (s == "low") config.priority = ThreadPriority::Low;
+            else if (s == "lowest") config.priority = ThreadPriority::Lowest;
+            else config.priority = ThreadPriority::Normal;
+        }
+        return config;
+    }
+
+    static std::vector<int> ParseCpuList(const std::string& list) {
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (item.empty()) continue;
+            size_t dash = item.find('-');
+            int first = std::atoi(item.c_str());
+            int last = dash == std::string::npos ? first : std::atoi(item.c_str() + dash + 1);
+            for (int c = first; c <= last; ++c) {
+                if (c >= 0) cpus.push_back(c);
+            }
+        }
+        return cpus;
+    }
+};
+
+// Persistent render workers. The threads are created, pinned and given
+// their priority once; ParallelFor hands out chunks of [0, count) through
+// an atomic counter to the workers and the calling thread.
+class ThreadPool {
+public:
+    explicit ThreadPool(const ThreadConfig& config_ = ThreadConfig()) { Configure(config_); }
+    ~ThreadPool() { Stop(); }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Configure(const ThreadConfig& config_) {
+        Stop();
+        config = config_;
+        workerCpus.clear();
+        const unsigned count = config.WorkerCount();
+        const std::vector<int> allowed = AllowedCpus();
+        if (config.affinity != AffinityPolicy::None && !allowed.empty()) {
+            for (unsigned i = 1; i < count; ++i) {
+                size_t slot = config.affinity == AffinityPolicy::Compact
+                                  ? (i - 1) % allowed.size()
+                                  : ((i - 1) * allowed.size() / std::max(1u, count - 1)) % allowed.size();
+                workerCpus.push_back(allowed[slot]);
+            }
+        }
+
+        busySlots.assign(count, BusySlot());
+        parallelSeconds = 0.0;
+        stopping = false;
+        threads.reserve(count - 1);
+        for (unsigned i = 1; i < count; ++i) {
+            threads.emplace_back([this, i] { WorkerLoop(i - 1); });
+        }
+    }
+
+    const ThreadConfig& GetConfig() const { return config; }
+    unsigned WorkerCount() const { return static_cast<unsigned>(threads.size()) + 1; }
+
+    // Effective configuration, one line for logs.
+    std::string Describe() const {
+        std::ostringstream out;
+        out << WorkerCount() << " render thread(s) (" << DefaultWorkerCount() << " hardware)";
+        out << ", affinity ";
+        switch (config.affinity) {
+            case AffinityPolicy::None: out << "none"; break;
+            case AffinityPolicy::Compact: out << "compact"; break;
+            case AffinityPolicy::Scatter: out << "scatter"; break;
+        }
+        if (!workerCpus.empty()) {
+            out << " [";
+            for (size_t i = 0; i < workerCpus.size(); ++i) out << (i ? "," : "") << workerCpus[i];
+            out << "]";
+        }
+        out << ", priority ";
+        switch (config.priority) {
+            case ThreadPriority::Normal: out << "normal"; break;
+            case ThreadPriority::Low: out << "low"; break;
+            case ThreadPriority::Lowest: out << "lowest"; break;
+        }
+        return out.str();
+    }
+
+    template <typename Fn>
+    void ParallelFor(int count, int chunkSize, Fn&& fn) {
+        if (count <= 0) return;
+        chunkSize = std::max(1, chunkSize);
+        const auto start = std::chrono::steady_clock::now();
+        if (threads.empty() || count <= chunkSize) {
+            for (int begin = 0; begin < count; begin += chunkSize) {
+                fn(begin, std::min(count, begin + chunkSize));
+            }
+            const double elapsed = SecondsSince(start);
+            busySlots[0].seconds += elapsed;
+            parallelSeconds += elapsed;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobCount = count;
+            jobChunk = chunkSize;
+            jobContext = &fn;
+            jobInvoke = [](void* ctx, int begin, int end) {
+                (*static_cast<std::remove_reference_t<Fn>*>(ctx))(begin, end);
+            };
+            next.store(0, std::memory_order_relaxed);
+            busy = static_cast<int>(threads.size());
+            ++generation;
+        }
+        wake.notify_all();
+        RunChunks(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busy == 0; });
+        parallelSeconds += SecondsSince(start);
+    }
+
+    // 0 on the thread that calls ParallelFor, 1..WorkerCount()-1 on the
+    // pool's workers; indexes per-thread data such as render counters.
+    static unsigned CurrentWorkerIndex() { return CurrentIndex(); }
+
+    // Time the threads spent running chunks, summed over threads, and the
+    // wall time spent inside ParallelFor since the last ResetTiming().
+    // Their ratio over WorkerCount() is the thread utilization.
+    void ResetTiming() {
+        for (BusySlot& slot : busySlots) slot.seconds = 0.0;
+        parallelSeconds = 0.0;
+    }
+    double BusySeconds() const {
+        double total = 0.0;
+        for (const BusySlot& slot : busySlots) total += slot.seconds;
+        return total;
+    }
+    double ParallelSeconds() const { return parallelSeconds; }
+
+private:
+    ThreadConfig config;
+    std::vector<std::thread> threads;
+    std::vector<int> workerCpus;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation = 0;
+    int busy = 0;
+    bool stopping = false;
+
+    int jobCount = 0;
+    int jobChunk = 1;
+    void* jobContext = nullptr;
+    void (*jobInvoke)(void*, int, int) = nullptr;
+    std::atomic<int> next{0};
+
+    // one cache line per thread, so busy time is recorded without sharing
+    struct alignas(64) BusySlot {
+        double seconds = 0.0;
+    };
+    std::vector<BusySlot> busySlots;
+    double parallelSeconds = 0.0;
+
+    static unsigned& CurrentIndex() {
+        static thread_local unsigned index = 0;
+        return index;
+    }
+
+    static double SecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void RunChunks(unsigned slot) {
+        const auto start = std::chrono::steady_clock::now();
+        bool worked = false;
+        while (true) {
+            int begin = next.fetch_add(jobChunk, std::memory_order_relaxed);
+            if (begin >= jobCount) break;
+            jobInvoke(jobContext, begin, std::min(jobCount, begin + jobChunk));
+            worked = true;
+        }
+        if (worked) busySlots[slot].seconds += SecondsSince(start);
+    }
+
+    void WorkerLoop(unsigned index) {
+        CurrentIndex() = index + 1;
+        ApplyPlacement(index);
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            RunChunks(index + 1);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --busy;
+            }
+            done.notify_one();
+        }
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) {
+            if (t.joinable()) t.join();
+        }
+        threads.clear();
+    }
+
+    std::vector<int> AllowedCpus() const {
+        if (!config.cpus.empty()) return config.cpus;
+        std::vector<int> cpus;
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int c = 0; c < CPU_SETSIZE; ++c) {
+                if (CPU_ISSET(c, &set)) cpus.push_back(c);
+            }
+        }
+#endif
+        return cpus;
+    }
+
+    void ApplyPlacement(unsigned index) const {
+#if defined(__linux__)
+        if (index < workerCpus.size()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(workerCpus[index], &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+        // Linux keeps a nice value per thread
+        if (config.priority == ThreadPriority::Low) {
+            setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+        } else if (config.priority == ThreadPriority::Lowest) {
+            setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+        }
+#else
+        (void)index;
+#endif
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_PARALLEL_HPP
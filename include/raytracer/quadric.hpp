@@ -0,0 +1,273 @@
+#ifndef RAYTRACER_QUADRIC_HPP
+#define RAYTRACER_QUADRIC_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include "raytracer/object.hpp"
+#include "raytracer/simd.hpp"
+
+namespace raytracer {
+
+// a x^2 + b y^2 + c z^2 + e y + k, negative inside. Surfaces are symmetric
+// about the y axis through the object's position; any other orientation
+// comes from the object transform, so no cross or x/z linear terms.
+struct QuadricSurface {
+    float a = 0.0f, b = 0.0f, c = 0.0f, e = 0.0f, k = 0.0f;
+
+    template <typename T>
+    T Eval(T x, T y, T z) const {
+        return T(a) * x * x + T(b) * y * y + T(c) * z * z + T(e) * y + T(k);
+    }
+
+    template <typename T>
+    Vec3T<T> Gradient(const Vec3T<T>& p) const {
+        return Vec3T<T>(T(2) * T(a) * p.x, T(2) * T(b) * p.y + T(e), T(2) * T(c) * p.z);
+    }
+};
+
+// Up to four clipped quadrics intersected by one ray at once, one per lane.
+// A root on lane i counts when yMin <= y <= yMax and the lane's clip
+// quadric is <= 0 there. Caps are quadrics too (a plane is e y + k), so a
+// capped cylinder is a single call: side, bottom and top in three lanes.
+struct QuadricLanes {
+    alignas(16) float a[4], b[4], c[4], e[4], k[4];
+    alignas(16) float ca[4], cb[4], cc[4], ce[4], ck[4];
+    alignas(16) float yMin[4], yMax[4];
+    int count = 0;
+
+    QuadricLanes() { Clear(); }
+
+    void Clear() {
+        count = 0;
+        // empty lanes have no roots: 1 = 0
+        for (int i = 0; i < 4; ++i) Set(i, QuadricSurface{0, 0, 0, 0, 1}, QuadricSurface(), 0.0f, 0.0f);
+    }
+
+    void Add(const QuadricSurface& surface, const QuadricSurface& clip, float yMin_, float yMax_) {
+        if (count < 4) Set(count++, surface, clip, yMin_, yMax_);
+    }
+
+    QuadricSurface Surface(int lane) const { return {a[lane], b[lane], c[lane], e[lane], k[lane]}; }
+
+    // Nearest accepted root beyond HitEpsilon and before t; returns its lane
+    // and updates t, or -1.
+    template <typename T>
+    int Intersect(const RayT<T>& ray, T& t) const {
+        if constexpr (std::is_same_v<T, float>) {
+            return Intersect4(ray, t);
+        } else {
+            int best = -1;
+            for (int i = 0; i < count; ++i) {
+                const T A = T(a[i]) * ray.direction.x * ray.direction.x + T(b[i]) * ray.direction.y * ray.direction.y +
+                            T(c[i]) * ray.direction.z * ray.direction.z;
+                const T B = T(2) * (T(a[i]) * ray.origin.x * ray.direction.x + T(b[i]) * ray.origin.y * ray.direction.y +
+                                    T(c[i]) * ray.origin.z * ray.direction.z) +
+                            T(e[i]) * ray.direction.y;
+                const T C = Surface(i).Eval(ray.origin.x, ray.origin.y, ray.origin.z);
+                const T disc = B * B - T(4) * A * C;
+                if (disc < T(0)) continue;
+                const T root = std::sqrt(disc);
+                const T q = T(-0.5) * (B < T(0) ? B - root : B + root);
+                const T roots[2] = {q / A, C / q};
+                for (T r : roots) {
+                    if (!(r > HitEpsilon<T>() && r < t)) continue;
+                    const Vec3T<T> p = ray.At(r);
+                    if (p.y < T(yMin[i]) || p.y > T(yMax[i])) continue;
+                    const QuadricSurface clip{ca[i], cb[i], cc[i], ce[i], ck[i]};
+                    if (clip.Eval(p.x, p.y, p.z) > T(0)) continue;
+                    t = r;
+                    best = i;
+                }
+            }
+            return best;
+        }
+    }
+
+private:
+    void Set(int i, const QuadricSurface& s, const QuadricSurface& clip, float lo, float hi) {
+        a[i] = s.a; b[i] = s.b; c[i] = s.c; e[i] = s.e; k[i] = s.k;
+        ca[i] = clip.a; cb[i] = clip.b; cc[i] = clip.c; ce[i] = clip.e; ck[i] = clip.k;
+        yMin[i] = lo;
+        yMax[i] = hi;
+    }
+
+    // Same as the scalar path with all lanes in SIMD. Both roots come from
+    // the cancellation-free form q / A and C / q, which also covers A == 0
+    // (planes, rays along a cone's asymptote): q / A turns into inf or NaN
+    // and fails the range test.
+    int Intersect4(const Ray& ray, float& t) const {
+        const Float4 ox(ray.origin.x), oy(ray.origin.y), oz(ray.origin.z);
+        const Float4 dx(ray.direction.x), dy(ray.direction.y), dz(ray.direction.z);
+        const Float4 la = Float4::Load(a), lb = Float4::Load(b), lc = Float4::Load(c);
+        const Float4 le = Float4::Load(e), lk = Float4::Load(k);
+        const Float4 zero(0.0f);
+        const Float4 A = la * dx * dx + lb * dy * dy + lc * dz * dz;
+        const Float4 B = Float4(2.0f) * (la * ox * dx + lb * oy * dy + lc * oz * dz) + le * dy;
+        const Float4 C = la * ox * ox + lb * oy * oy + lc * oz * oz + le * oy + lk;
+        const Float4 disc = B * B - Float4(4.0f) * A * C;
+        const Float4 root = Sqrt(Max(disc, zero));
+        const Float4 q = Float4(-0.5f) * (B + Select(B < zero, zero - root, root));
+        const int lanes = ~MoveMask(disc < zero) & ((1 << count) - 1);
+        if (!lanes) return -1;
+
+        const Float4 lo = Float4::Load(yMin), hi = Float4::Load(yMax);
+        const Float4 kca = Float4::Load(ca), kcb = Float4::Load(cb), kcc = Float4::Load(cc);
+        const Float4 kce = Float4::Load(ce), kck = Float4::Load(ck);
+        const Float4 eps(HitEpsilon<float>()), tMax(t);
+        auto accepted = [&](Float4 r) {
+            const Float4 px = ox + r * dx, py = oy + r * dy, pz = oz + r * dz;
+            const Float4 clip = kca * px * px + kcb * py * py + kcc * pz * pz + kce * py + kck;
+            const Float4 reject = (py < lo) | (py > hi) | (clip > zero);
+            return MoveMask((r > eps) & (r < tMax)) & ~MoveMask(reject) & lanes;
+        };
+        const Float4 r0 = q / A, r1 = C / q;
+        const int m0 = accepted(r0), m1 = accepted(r1);
+        if (!(m0 | m1)) return -1;
+
+        alignas(16) float t0[4], t1[4];
+        r0.Store(t0);
+        r1.Store(t1);
+        int best = -1;
+        for (int i = 0; i < 4; ++i) {
+            if ((m0 >> i) & 1 && t0[i] < t) {
+                t = t0[i];
+                best = i;
+            }
+            if ((m1 >> i) & 1 && t1[i] < t) {
+                t = t1[i];
+                best = i;
+            }
+        }
+        return best;
+    }
+};
+
+enum class QuadricKind {
+    Cylinder,
+    Cone,         // apex at the top
+    Paraboloid,   // vertex at the bottom, opening upwards
+    Hyperboloid,  // one sheet, narrowest (waist) in the middle
+    Ellipsoid,
+};
+
+inline const char* QuadricKindName(QuadricKind kind) {
+    switch (kind) {
+        case QuadricKind::Cylinder: return "Cylinder";
+        case QuadricKind::Cone: return "Cone";
+        case QuadricKind::Paraboloid: return "Paraboloid";
+        case QuadricKind::Hyperboloid: return "Hyperboloid";
+        case QuadricKind::Ellipsoid: return "Ellipsoid";
+    }
+    return "Quadric";
+}
+
+// Cylinder, cone, paraboloid, hyperboloid or ellipsoid along the y axis,
+// radius at the widest end and cut to `height` (centred on the position).
+// Every kind is one QuadricSurface plus optional cap planes, all
+// intersected by the shared QuadricLanes routine; the shape is rebuilt in
+// SetShape, never during intersection.
+class Quadric : public ObjectImpl<Quadric> {
+public:
+    Quadric(QuadricKind kind_ = QuadricKind::Cylinder, float radius_ = 1.0f, float height_ = 2.0f,
+            const std::string& name_ = "")
+        : ObjectImpl(name_.empty() ? QuadricKindName(kind_) : name_), kind(kind_) {
+        SetShape(radius_, height_, radius_ * 0.5f, true);
+    }
+
+    QuadricKind Kind() const { return kind; }
+    float Radius() const { return radius; }
+    float Height() const { return height; }
+    float Waist() const { return waist; }  // hyperboloid only
+    bool Capped() const { return capped; }
+
+    void SetShape(float radius_, float height_, float waist_, bool capped_) {
+        radius = std::max(0.01f, radius_);
+        height = std::max(0.01f, height_);
+        waist = std::clamp(waist_, 0.01f, radius);
+        capped = capped_;
+        Rebuild();
+    }
+
+    template <typename T>
+    HitResultT<T> IntersectT(const RayT<T>& ray) const {
+        HitResultT<T> result;
+        const RayT<T> local = RayT<T>::FromUnit(ray.origin - Vec3T<T>(position), ray.direction);
+        T t = std::numeric_limits<T>::max();
+        const int lane = lanes.Intersect(local, t);
+        if (lane < 0) return result;
+        result.hit = true;
+        result.t = t;
+        result.point = ray.At(t);
+        result.normal = lanes.Surface(lane).Gradient(local.At(t)).Normalized();
+        result.object = this;
+        return result;
+    }
+
+    void GetLocalBoundingBox(Vec3& min, Vec3& max) const override {
+        const Vec3 half(radius, 0.5f * height, radius);
+        min = position - half;
+        max = position + half;
+    }
+
+    bool ContainsLocalPoint(const Vec3& point) const override {
+        const Vec3 p = point - position;
+        return std::fabs(p.y) <= 0.5f * height && side.Eval(p.x, p.y, p.z) <= 0.0f;
+    }
+
+private:
+    QuadricKind kind;
+    float radius = 1.0f;
+    float height = 2.0f;
+    float waist = 0.5f;
+    bool capped = true;
+    QuadricSurface side;
+    QuadricLanes lanes;
+
+    void Rebuild() {
+        const float h = 0.5f * height;
+        const float r2 = radius * radius;
+        float bottomRadius = radius, topRadius = radius;
+        switch (kind) {
+            case QuadricKind::Cylinder:
+                side = {1, 0, 1, 0, -r2};
+                break;
+            case QuadricKind::Cone: {
+                // x^2 + z^2 = s (h - y)^2 with radius at y = -h
+                const float s = r2 / (4.0f * h * h);
+                side = {1, -s, 1, 2.0f * s * h, -s * h * h};
+                topRadius = 0.0f;
+                break;
+            }
+            case QuadricKind::Paraboloid:
+                // x^2 + z^2 = r^2 (y + h) / height
+                side = {1, 0, 1, -r2 / height, -r2 * h / height};
+                bottomRadius = 0.0f;
+                break;
+            case QuadricKind::Hyperboloid: {
+                // x^2 + z^2 = waist^2 + s y^2 with radius at y = +-h
+                const float s = (r2 - waist * waist) / (h * h);
+                side = {1, -s, 1, 0, -waist * waist};
+                break;
+            }
+            case QuadricKind::Ellipsoid:
+                side = {1.0f / r2, 1.0f / (h * h), 1.0f / r2, 0, -1};
+                bottomRadius = topRadius = 0.0f;
+                break;
+        }
+
+        const float inf = std::numeric_limits<float>::infinity();
+        // the clip keeps a cap inside the side surface; the side lane has
+        // no clip besides its height range (-1 <= 0 everywhere)
+        lanes.Clear();
+        lanes.Add(side, QuadricSurface{0, 0, 0, 0, -1}, -h, h);
+        if (capped && bottomRadius > 0.0f) lanes.Add(QuadricSurface{0, 0, 0, -1, -h}, side, -inf, inf);
+        if (capped && topRadius > 0.0f) lanes.Add(QuadricSurface{0, 0, 0, 1, -h}, side, -inf, inf);
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_QUADRIC_HPP
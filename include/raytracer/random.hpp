@@ -0,0 +1,61 @@
+#ifndef RAYTRACER_RANDOM_HPP
+#define RAYTRACER_RANDOM_HPP
+
+#include <cstdint>
+
+namespace raytracer {
+
+// Counter-based generator (Philox4x32-10, Salmon et al. 2011). The sequence
+// is a pure function of (pixel, sample index, frame), so a pixel gets the
+// same numbers whichever thread, process or machine renders it.
+struct Rng {
+    uint32_t key[2];
+    uint32_t counter[4];  // block number, sample index, frame (low, high)
+    uint32_t block[4];
+    int used = 4;
+
+    Rng() : Rng(0, 0, 0) {}
+    Rng(uint64_t pixel, uint32_t sampleIndex, uint64_t frame)
+        : key{static_cast<uint32_t>(pixel), static_cast<uint32_t>(pixel >> 32)},
+          counter{0, sampleIndex, static_cast<uint32_t>(frame), static_cast<uint32_t>(frame >> 32)},
+          block{0, 0, 0, 0} {}
+
+    uint32_t NextUInt() {
+        if (used == 4) {
+            Philox(counter, key, block);
+            ++counter[0];
+            used = 0;
+        }
+        return block[used++];
+    }
+
+    // Uniform float in [0, 1).
+    float NextFloat() {
+        return static_cast<float>(NextUInt() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    static void Philox(const uint32_t* ctr, const uint32_t* k, uint32_t* out) {
+        uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+        uint32_t k0 = k[0], k1 = k[1];
+        for (int round = 0; round < 10; ++round) {
+            const uint64_t p0 = 0xD2511F53ull * c0;
+            const uint64_t p1 = 0xCD9E8D57ull * c2;
+            const uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            const uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            c1 = static_cast<uint32_t>(p1);
+            c3 = static_cast<uint32_t>(p0);
+            c0 = n0;
+            c2 = n2;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_RANDOM_HPP
@@ -5,19 +5,33 @@
 
 namespace raytracer {
 
-struct Ray {
-    Vec3 origin;
-    Vec3 direction;
+template <typename T>
+struct RayT {
+    Vec3T<T> origin;
+    Vec3T<T> direction;
 
-    Ray() {}
-    Ray(const Vec3& origin_, const Vec3& direction_) 
+    RayT() {}
+    RayT(const Vec3T<T>& origin_, const Vec3T<T>& direction_) 
         : origin(origin_), direction(direction_.Normalized()) {}
+    template <typename U>
+    explicit RayT(const RayT<U>& o) : origin(o.origin), direction(o.direction) {}
+
+    // For directions that are already unit length.
+    static RayT FromUnit(const Vec3T<T>& origin_, const Vec3T<T>& unitDirection) {
+        RayT ray;
+        ray.origin = origin_;
+        ray.direction = unitDirection;
+        return ray;
+    }
 
-    Vec3 At(float t) const {
+    Vec3T<T> At(T t) const {
         return origin + direction * t;
     }
 };
 
+using Ray = RayT<float>;
+using RayD = RayT<double>;
+
 } // namespace raytracer
 
 #endif // RAYTRACER_RAY_HPP
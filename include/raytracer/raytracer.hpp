@@ -2,103 +2,836 @@
 #define RAYTRACER_RAYTRACER_HPP
 
 #include <algorithm>
-#include <atomic>
-#include <thread>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include "raytracer/scene.hpp"
 #include "raytracer/camera.hpp"
+#include "raytracer/alloc_counter.hpp"
+#include "raytracer/antialias.hpp"
+#include "raytracer/bvh.hpp"
+#include "raytracer/color.hpp"
+#include "raytracer/denoiser.hpp"
+#include "raytracer/gbuffer.hpp"
 #include "raytracer/ray.hpp"
+#include "raytracer/light_tree.hpp"
+#include "raytracer/medium.hpp"
+#include "raytracer/parallel.hpp"
+#include "raytracer/random.hpp"
+#include "raytracer/render_stats.hpp"
+#include "raytracer/sampling.hpp"
+#include "raytracer/spectrum.hpp"
 #include "dr4/math/color.hpp"
 #include "dr4/texture.hpp"
 
 namespace raytracer {
 
+enum class LightSampling {
+    Auto,       // all lights up to lightTreeThreshold, light tree above it
+    AllLights,  // one shadow ray per light per shading point
+    LightTree,  // lightSamples lights per shading point, chosen by importance
+};
+
+enum class Integrator {
+    Preview,    // ambient + direct lighting, fast enough for navigation
+    PathTrace,  // unbiased Monte Carlo path tracing for lighting analysis
+};
+
+// Shading features fixed for a whole frame. ShadeRay and TracePath are
+// instantiated for every combination, so a disabled feature costs nothing
+// per ray; Render picks the instantiation once per frame.
+enum ShadeFeature : unsigned {
+    kShadeShadows = 1u << 0,      // shadow rays towards the lights
+    kShadeSoftShadows = 1u << 1,  // area sampling of spherical lights (needs kShadeShadows)
+    kShadeSecondary = 1u << 2,    // mirror reflections in the preview
+    kShadeLights = 1u << 3,       // the scene has light objects
+    kShadeLightTree = 1u << 4,    // many lights, sampled through the light tree
+    kShadeMedia = 1u << 5,        // scattering media in objects or the scene
+    kShadeSpectral = 1u << 6,     // hero-wavelength path tracing
+};
+
+constexpr unsigned kPreviewFeatureMask =
+    kShadeShadows | kShadeSoftShadows | kShadeSecondary | kShadeLights | kShadeLightTree | kShadeMedia;
+constexpr unsigned kPathFeatureMask = kShadeLights | kShadeLightTree | kShadeMedia | kShadeSpectral;
+
+enum class Precision {
+    Single,  // float, used by the viewport
+    Double,  // double, for optical path analysis
+};
+
+// Polyline of a ray traced by RayTracer::TraceOpticalPath.
+struct OpticalPath {
+    std::vector<Vec3d> points;
+    double opticalLength = 0.0;          // sum of refractive index * segment length
+    bool escaped = false;                // left the scene instead of stopping on a surface
+    const Object* lastObject = nullptr;
+};
+
 class RayTracer {
 public:
     Scene* scene;
     Camera* camera;
     int maxBounces = 3;
     int samplesPerPixel = 1;
+    LightSampling lightSampling = LightSampling::Auto;
+    int lightSamples = 4;
+    int lightTreeThreshold = 16;
+    bool softShadows = true;
+    int shadowSamples = 2;
+    bool progressive = true;
+    int maxAccumulatedFrames = 64;
+    Integrator integrator = Integrator::Preview;
+    int pathMaxDepth = 16;
+    int pathMaxFrames = 4096;
+    float pathLightIntensity = 200.0f;
+    bool spectral = false;
+    bool previewReflections = false;  // trace mirror reflections up to maxBounces in the preview
+    bool navigationShadows = false;   // keep shadows in preview frames rendered while the camera moves
+    uint64_t frameIndex = 0;          // keys the random numbers with pixel and sample index; change per animation frame
+    bool denoise = false;
+    int denoiseMaxFrames = 256;  // accumulated frames after which the image is left unfiltered
+    Denoiser denoiser;
+    bool antialias = true;  // post-process AA of preview frames; path tracing jitters its rays instead
+    Antialiaser antialiaser;
+    int volumeSamples = 2;    // in-scattering samples per ray in a homogeneous medium
+    int volumeMaxSteps = 32;  // ray-marching steps per ray in a heterogeneous medium
+    bool tileCulling = true;  // primary rays test only the objects in their tile's frustum
 
-    RayTracer(Scene* scene_, Camera* camera_)
-        : scene(scene_), camera(camera_) {}
+    RayTracer(Scene* scene_, Camera* camera_, const ThreadConfig& threads = ThreadConfig::FromEnvironment())
+        : scene(scene_), camera(camera_), threadPool(threads) {}
 
-    dr4::Color TraceRay(const Ray& ray, const std::vector<const Object*>& lights, int depth = 0) {
-        if (depth >= maxBounces) {
-            return dr4::Color(0, 0, 0);
-        }
+    // Restarts the render workers with a new thread count, affinity and priority.
+    void SetThreadConfig(const ThreadConfig& threads) { threadPool.Configure(threads); }
+    const ThreadConfig& GetThreadConfig() const { return threadPool.GetConfig(); }
+    unsigned GetRenderThreadCount() const { return threadPool.WorkerCount(); }
+    std::string DescribeThreads() const { return threadPool.Describe(); }
 
-        HitResult closestHit;
-        closestHit.t = 1e10f;
+    // candidates, if given, replaces the scene BVH with a list of object
+    // indices in increasing order (see TileCandidates).
+    template <typename T>
+    HitResultT<T> FindClosestHitT(const RayT<T>& ray, int* objectId = nullptr,
+                                  const std::vector<uint32_t>* candidates = nullptr) const {
+        HitResultT<T> closestHit;
+        closestHit.t = T(1e10);
+        int closestId = -1;
+        uint64_t tests = 0;
 
-        for (auto& obj : scene->objects) {
-            HitResult hit = obj->Intersect(ray);
-            if (hit.hit && hit.t < closestHit.t && hit.t > 0.001f) {
+        // ties go to the lower index, as in a plain scan of the list
+        auto visit = [&](uint32_t index) {
+            const int i = static_cast<int>(index);
+            if (scene->objects[index]->IsVolume()) return false;
+            HitResultT<T> hit = scene->objects[index]->Intersect(ray);
+            ++tests;
+            if (hit.hit && hit.t > HitEpsilon<T>() &&
+                (hit.t < closestHit.t || (hit.t == closestHit.t && i < closestId))) {
                 closestHit = hit;
+                closestId = i;
+            }
+            return false;
+        };
+        if (candidates) {
+            for (uint32_t index : *candidates) visit(index);
+        } else if (sceneBvhReady) {
+            sceneBvh.Traverse(ray, closestHit.t, visit);
+        } else {
+            const uint32_t objectCount = static_cast<uint32_t>(scene->objects.size());
+            for (uint32_t i = 0; i < objectCount; ++i) visit(i);
+        }
+        const uint64_t marchSteps = std::exchange(ThreadMarchSteps(), 0);
+        if (RayCounters* counters = ThreadCounters()) {
+            ++counters->closestHitRays;
+            counters->intersectionTests += tests;
+            counters->marchSteps += marchSteps;
+        }
+        if (objectId) *objectId = closestId;
+        return closestHit;
+    }
+
+    HitResult FindClosestHit(const Ray& ray, int* objectId = nullptr) const {
+        return FindClosestHitT(ray, objectId);
+    }
+
+    // Follows one ray at one wavelength through the scene for optical
+    // analysis: refracts through dielectrics (Object::IndexAt), reflects off
+    // mirrors (reflectivity >= 0.5) and stops at the first other surface.
+    // Segments restart exactly at the hit point (HitEpsilon<T> rejects the
+    // self-hit), so no path length is lost to origin offsets.
+    // Precision::Double runs the intersection code in double; results are
+    // returned in double either way.
+    OpticalPath TraceOpticalPath(const RayD& ray, float wavelengthNm, int maxSegments = 64,
+                                 Precision precision = Precision::Double) const {
+        return precision == Precision::Double ? TraceOpticalPathT<double>(ray, wavelengthNm, maxSegments)
+                                              : TraceOpticalPathT<float>(RayT<float>(ray), wavelengthNm, maxSegments);
+    }
+
+    template <typename T>
+    OpticalPath TraceOpticalPathT(RayT<T> ray, float wavelengthNm, int maxSegments) const {
+        OpticalPath path;
+        path.points.push_back(Vec3d(ray.origin));
+        T mediumIndex = 1;
+
+        for (int segment = 0; segment < maxSegments; ++segment) {
+            HitResultT<T> hit = FindClosestHitT(ray);
+            if (!hit.hit) {
+                path.escaped = true;
+                break;
+            }
+            path.points.push_back(Vec3d(hit.point));
+            path.opticalLength += static_cast<double>(mediumIndex) * static_cast<double>(hit.t);
+            path.lastObject = hit.object;
+
+            const Object* obj = hit.object;
+            const bool entering = hit.normal.Dot(ray.direction) < 0;
+            const Vec3T<T> n = entering ? hit.normal : -hit.normal;
+            const T cosI = -n.Dot(ray.direction);
+            const Vec3T<T> reflected = ray.direction + n * (T(2) * cosI);
+
+            if (obj->refractiveIndex > 1.0f) {
+                const T ior = obj->IndexAt(wavelengthNm);
+                const T nextIndex = entering ? ior : T(1);
+                const T eta = mediumIndex / nextIndex;
+                const T sin2T = eta * eta * std::max(T(0), T(1) - cosI * cosI);
+                if (sin2T >= T(1)) {
+                    ray = RayT<T>::FromUnit(hit.point, reflected);
+                } else {
+                    const Vec3T<T> dir = ray.direction * eta + n * (eta * cosI - std::sqrt(T(1) - sin2T));
+                    ray = RayT<T>::FromUnit(hit.point, dir.Normalized());
+                    mediumIndex = nextIndex;
+                }
+            } else if (obj->reflectivity >= 0.5f) {
+                ray = RayT<T>::FromUnit(hit.point, reflected);
+            } else {
+                break;
+            }
+        }
+        return path;
+    }
+
+    // Finds the closest hit among the candidates (all objects if null) and,
+    // if primary is set, records it into the G-buffer sample.
+    HitResult FindPrimaryHit(const Ray& ray, GBufferSample* primary,
+                             const std::vector<uint32_t>* candidates = nullptr) const {
+        if (!primary) return FindClosestHitT(ray, nullptr, candidates);
+        HitResult hit = FindClosestHitT(ray, &primary->objectId, candidates);
+        if (hit.hit) {
+            primary->normal = hit.normal;
+            primary->depth = hit.t;
+        }
+        return hit;
+    }
+
+    // Any-hit test: stops at the first blocker closer than maxDist.
+    bool Occluded(const Ray& ray, float maxDist, const Object* self) const {
+        uint64_t tests = 0;
+        bool occluded = false;
+        auto visit = [&](uint32_t index) {
+            const Object* objCheck = scene->objects[index].get();
+            if (objCheck == self || objCheck->isLightSource || objCheck->IsVolume()) return false;
+            ++tests;
+            HitResult shadowHit = objCheck->Intersect(ray);
+            occluded = shadowHit.hit && shadowHit.t > 0.001f && shadowHit.t < maxDist;
+            return occluded;
+        };
+        if (sceneBvhReady) {
+            sceneBvh.Traverse(ray, maxDist, visit);
+        } else {
+            const uint32_t objectCount = static_cast<uint32_t>(scene->objects.size());
+            for (uint32_t i = 0; i < objectCount && !visit(i); ++i) {}
+        }
+        const uint64_t marchSteps = std::exchange(ThreadMarchSteps(), 0);
+        if (RayCounters* counters = ThreadCounters()) {
+            ++counters->shadowRays;
+            counters->intersectionTests += tests;
+            counters->marchSteps += marchSteps;
+        }
+        return occluded;
+    }
+
+    // Diffuse term of a single light at the hit point. With kShadeSoftShadows
+    // spherical lights are sampled over their visible cap with shadowSamples
+    // stratified rays; a point inside the light sphere has no cap and is lit
+    // as by a point light.
+    template <unsigned Features>
+    float DirectLight(const HitResult& hit, const Object* light, Rng& rng) const {
+        const Vec3 origin = hit.point + hit.normal * 0.01f;
+        const float radius = light->GetEmitterRadius();
+        const bool insideLight = (light->position - hit.point).LengthSquared() <= radius * radius;
+
+        if ((Features & kShadeSoftShadows) && shadowSamples > 0 && radius > 0.0f && !insideLight) {
+            const int count = std::min(shadowSamples, kMaxStratifiedSamples);
+            float u[kMaxStratifiedSamples];
+            float v[kMaxStratifiedSamples];
+            StratifiedSamples2D(count, rng, u, v);
+
+            float sum = 0.0f;
+            for (int i = 0; i < count; ++i) {
+                Vec3 dir;
+                float dist = 0.0f;
+                if (!SampleSphereCap(hit.point, light->position, radius, u[i], v[i], dir, dist)) continue;
+                float ndotl = hit.normal.Dot(dir);
+                if (ndotl <= 0.0f) continue;
+                if (Occluded(Ray(origin, dir), dist, hit.object)) continue;
+                sum += ndotl * 1.4f / (1.0f + 0.02f * dist);
+            }
+            return sum / static_cast<float>(count);
+        }
+
+        Vec3 toLight = light->position - hit.point;
+        float dist = toLight.Length();
+        Vec3 lightDir = toLight / std::max(1e-4f, dist);
+
+        float ndotl = std::max(0.0f, hit.normal.Dot(lightDir));
+        if (ndotl <= 0.0f) return 0.0f;
+        if constexpr ((Features & kShadeShadows) != 0) {
+            if (Occluded(Ray(origin, lightDir), dist, hit.object)) return 0.0f;
+        } else {
+            (void)origin;
+        }
+
+        float atten = 1.0f / (1.0f + 0.02f * dist);
+        return ndotl * atten * 1.4f;
+    }
+
+    bool UsesLightTree(size_t lightCount) const {
+        switch (lightSampling) {
+            case LightSampling::AllLights: return false;
+            case LightSampling::LightTree: return true;
+            case LightSampling::Auto: break;
+        }
+        return static_cast<int>(lightCount) > lightTreeThreshold;
+    }
+
+    // Surface colour of a hit in linear RGB: Object::color, blended towards
+    // texture.color2 by the texture pattern. One point at a time, for
+    // secondary hits; primary hits go through SurfaceAlbedos.
+    ColorF SurfaceAlbedo(const HitResult& hit) const {
+        const Object* obj = hit.object;
+        const ColorF base = ColorF::FromSrgb(obj->color);
+        if (obj->texture.kind == TextureKind::None) return base;
+        const Transform& xf = obj->GetTransform();
+        const Float4 w = obj->texture.Pattern(Vec3x4(xf.PointToLocal(hit.point, obj->position)),
+                                              Vec3x4(xf.NormalToLocal(hit.normal)));
+        return base * (1.0f - w[0]) + ColorF::FromSrgb(obj->texture.color2) * w[0];
+    }
+
+    // SurfaceAlbedo for a packet of primary hits: textured points are
+    // gathered into lanes and each texture seen in the packet is evaluated
+    // once for all of them.
+    void SurfaceAlbedos(const HitResult* hits, int count, ColorF* out) const {
+        alignas(32) float px[Float8::kLanes] = {}, py[Float8::kLanes] = {}, pz[Float8::kLanes] = {};
+        alignas(32) float nx[Float8::kLanes] = {}, ny[Float8::kLanes] = {}, nz[Float8::kLanes] = {};
+        int textured = 0;
+        for (int i = 0; i < count; ++i) {
+            if (!hits[i].hit) continue;
+            const Object* obj = hits[i].object;
+            out[i] = ColorF::FromSrgb(obj->color);
+            if (obj->texture.kind == TextureKind::None) continue;
+            const Transform& xf = obj->GetTransform();
+            const Vec3 p = xf.PointToLocal(hits[i].point, obj->position);
+            const Vec3 n = xf.NormalToLocal(hits[i].normal);
+            px[i] = p.x; py[i] = p.y; pz[i] = p.z;
+            nx[i] = n.x; ny[i] = n.y; nz[i] = n.z;
+            textured |= 1 << i;
+        }
+        if (!textured) return;
+        const Vec3x8 p(Float8::Load(px), Float8::Load(py), Float8::Load(pz));
+        const Vec3x8 n(Float8::Load(nx), Float8::Load(ny), Float8::Load(nz));
+        while (textured) {
+            int first = 0;
+            while (!((textured >> first) & 1)) ++first;
+            const Object* obj = hits[first].object;
+            alignas(32) float w[Float8::kLanes];
+            obj->texture.Pattern(p, n).Store(w);
+            const ColorF second = ColorF::FromSrgb(obj->texture.color2);
+            for (int i = first; i < count; ++i) {
+                if (!((textured >> i) & 1) || hits[i].object != obj) continue;
+                out[i] = out[i] * (1.0f - w[i]) + second * w[i];
+                textured &= ~(1 << i);
             }
         }
+    }
 
+    template <unsigned Features>
+    ColorF TraceRay(const Ray& ray, const std::vector<const Object*>& lights, Rng& rng, int depth) {
+        const HitResult hit = FindClosestHit(ray);
+        return ShadeRay<Features>(ray, hit, hit.hit ? SurfaceAlbedo(hit) : ColorF(), lights, rng, depth);
+    }
+
+    // Preview shading in linear RGB: the surface as seen through the media
+    // in front of it.
+    template <unsigned Features>
+    ColorF ShadeRay(const Ray& ray, const HitResult& closestHit, const ColorF& albedo,
+                    const std::vector<const Object*>& lights, Rng& rng, int depth) {
+        const ColorF surface = ShadeSurface<Features>(ray, closestHit, albedo, lights, rng, depth);
+        if constexpr ((Features & kShadeMedia) != 0) {
+            const float tEnd = closestHit.hit ? closestHit.t : std::numeric_limits<float>::infinity();
+            const MediaSegment media = TraceMedia<Features, false>(ray, tEnd, lights, rng);
+            return surface * media.transmittance + media.scattered;
+        } else {
+            return surface;
+        }
+    }
+
+    // Ambient + sun + diffuse from the lights, blended with the mirror
+    // reflection when kShadeSecondary is set.
+    template <unsigned Features>
+    ColorF ShadeSurface(const Ray& ray, const HitResult& closestHit, const ColorF& albedo,
+                        const std::vector<const Object*>& lights, Rng& rng, int depth) {
         if (!closestHit.hit) {
-            return dr4::Color(15, 17, 28); 
+            return ColorF::FromSrgb(dr4::Color(15, 17, 28));
         }
 
         const Object* obj = closestHit.object;
         
-        if (obj->isLightSource) {
-            return dr4::Color(255, 255, 255);
+        if constexpr ((Features & kShadeLights) != 0) {
+            if (obj->isLightSource) {
+                return ColorF(1.0f, 1.0f, 1.0f);
+            }
         }
 
-        float ambient = 0.45f;
-        float r = obj->color.r * ambient;
-        float g = obj->color.g * ambient;
-        float b = obj->color.b * ambient;
-
+        float light = 0.45f;
 
         Vec3 dirLight = Vec3(0.3f, 0.8f, 0.5f).Normalized();
         float ndotlDir = std::max(0.0f, closestHit.normal.Dot(dirLight));
-        float dirStrength = 0.35f * ndotlDir;
-        r += obj->color.r * dirStrength;
-        g += obj->color.g * dirStrength;
-        b += obj->color.b * dirStrength;
-
-
-        for (const Object* light : lights) {
-            Vec3 lightPos = light->position;
-            Vec3 toLight = lightPos - closestHit.point;
-            float dist = toLight.Length();
-            Vec3 lightDir = toLight / std::max(1e-4f, dist);
-
-
-            Ray shadowRay(closestHit.point + closestHit.normal * 0.01f, lightDir);
-            bool occluded = false;
-            for (auto& objCheck : scene->objects) {
-                if (objCheck.get() == obj) continue;
-                if (objCheck->isLightSource) continue;
-                HitResult shadowHit = objCheck->Intersect(shadowRay);
-                if (shadowHit.hit && shadowHit.t > 0.001f && shadowHit.t < dist) {
-                    occluded = true;
+        light += 0.35f * ndotlDir;
+
+        if constexpr ((Features & kShadeLightTree) != 0) {
+            // Each sample is weighted by 1 / (pdf * count), so the expected
+            // value equals the sum over all lights.
+            const int count = std::max(1, lightSamples);
+            for (int i = 0; i < count; ++i) {
+                float pdf = 0.0f;
+                const Object* l = lightTree.Sample(closestHit.point, closestHit.normal, rng.NextFloat(), pdf);
+                if (!l || pdf <= 0.0f) continue;
+                light += DirectLight<Features>(closestHit, l, rng) / (pdf * static_cast<float>(count));
+            }
+        } else if constexpr ((Features & kShadeLights) != 0) {
+            for (const Object* l : lights) {
+                light += DirectLight<Features>(closestHit, l, rng);
+            }
+        }
+
+        ColorF color = albedo * light;
+
+        if constexpr ((Features & kShadeSecondary) != 0) {
+            if (obj->reflectivity > 0.0f && depth + 1 < maxBounces) {
+                const Vec3& n = closestHit.normal;
+                Vec3 dir = ray.direction - n * (2.0f * n.Dot(ray.direction));
+                ColorF reflected = TraceRay<Features>(Ray(closestHit.point + n * 0.001f, dir), lights, rng, depth + 1);
+                color = color * (1.0f - obj->reflectivity) + reflected * obj->reflectivity;
+            }
+        } else {
+            (void)depth;
+        }
+        return color;
+    }
+
+    // Emitted radiance of a light object. pathLightIntensity is the radiant
+    // intensity of a white light, so brightness does not depend on its radius.
+    ColorF LightRadiance(const Object* light) const {
+        float radius = light->GetEmitterRadius();
+        float scale = radius > 0.0f ? pathLightIntensity / (3.14159265f * radius * radius) : pathLightIntensity;
+        return ColorF::FromSrgb(light->color) * scale;
+    }
+
+    // Next-event estimation: reflected radiance at a Lambertian point from the
+    // sun and the lights, divided by the albedo.
+    template <unsigned Features>
+    ColorF SampleDirect(const HitResult& hit, const Vec3& n, const std::vector<const Object*>& lights, Rng& rng) const {
+        const float invPi = 0.31830989f;
+        const Vec3 origin = hit.point + n * 0.01f;
+        ColorF result;
+
+        Vec3 sunDir = Vec3(0.3f, 0.8f, 0.5f).Normalized();
+        float sunCos = n.Dot(sunDir);
+        if (sunCos > 0.0f && !Occluded(Ray(origin, sunDir), 1e30f, hit.object)) {
+            result += ColorF(0.35f, 0.35f, 0.35f) * sunCos;
+        }
+
+        auto sampleLight = [&](const Object* light, float selectPdf) {
+            float radius = light->GetEmitterRadius();
+            Vec3 dir;
+            float dist = 0.0f;
+            float weight = 0.0f;
+            if (radius > 0.0f) {
+                if (!SampleSphereCap(hit.point, light->position, radius, rng.NextFloat(), rng.NextFloat(), dir, dist)) {
+                    return;
+                }
+                Vec3 toCenter = light->position - hit.point;
+                float cosMax = std::sqrt(std::max(0.0f, 1.0f - radius * radius / toCenter.LengthSquared()));
+                weight = 2.0f * 3.14159265f * (1.0f - cosMax);
+            } else {
+                Vec3 toLight = light->position - hit.point;
+                dist = toLight.Length();
+                dir = toLight / std::max(1e-4f, dist);
+                weight = 1.0f / std::max(1e-8f, dist * dist);
+            }
+            float cosTheta = n.Dot(dir);
+            if (cosTheta <= 0.0f) return;
+            if (Occluded(Ray(origin, dir), dist, hit.object)) return;
+            result += LightRadiance(light) * (cosTheta * invPi * weight / selectPdf);
+        };
+
+        if constexpr ((Features & kShadeLightTree) != 0) {
+            float pdf = 0.0f;
+            const Object* light = lightTree.Sample(hit.point, n, rng.NextFloat(), pdf);
+            if (light && pdf > 0.0f) sampleLight(light, pdf);
+        } else if constexpr ((Features & kShadeLights) != 0) {
+            for (const Object* light : lights) sampleLight(light, 1.0f);
+        } else {
+            (void)sampleLight;
+            (void)lights;
+        }
+        return result;
+    }
+
+    // Schlick reflectance of a dielectric interface; sin2T receives the squared
+    // sine of the refraction angle (>= 1 means total internal reflection).
+    static float Fresnel(float cosI, float eta, bool entering, float& sin2T) {
+        sin2T = eta * eta * std::max(0.0f, 1.0f - cosI * cosI);
+        if (sin2T >= 1.0f) return 1.0f;
+        float r0 = (1.0f - eta) / (1.0f + eta);
+        r0 *= r0;
+        float c = 1.0f - (entering ? cosI : std::sqrt(1.0f - sin2T));
+        return r0 + (1.0f - r0) * c * c * c * c * c;
+    }
+
+    // Light a medium carries along a ray segment: the transmittance of
+    // whatever lies behind it and the radiance it scatters into the ray.
+    struct MediaSegment {
+        float transmittance = 1.0f;
+        ColorF scattered;
+    };
+
+    // Object holding a medium, with the box it had when the frame started.
+    struct FrameVolume {
+        const Object* object;
+        BvhNode box;
+        bool bounded;
+    };
+
+    // Media between the ray origin and tEnd. Volume objects are composited
+    // front to back in order of entry, the scene medium around all of them.
+    // Path selects the path tracer's light units and always-on shadows.
+    template <unsigned Features, bool Path>
+    MediaSegment TraceMedia(const Ray& ray, float tEnd, const std::vector<const Object*>& lights, Rng& rng) {
+        struct Span {
+            const Object* object;
+            float t0, t1;
+        };
+        constexpr int kMaxSpans = 8;
+        Span spans[kMaxSpans];
+        int count = 0;
+        for (const FrameVolume& volume : frameVolumes) {
+            // the nearest kMaxSpans spans are kept
+            float t0, t1;
+            if (!VolumeSpan(volume, ray, tEnd, t0, t1)) continue;
+            if (count == kMaxSpans && spans[count - 1].t0 <= t0) continue;
+            int i = count < kMaxSpans ? count++ : kMaxSpans - 1;
+            for (; i > 0 && spans[i - 1].t0 > t0; --i) spans[i] = spans[i - 1];
+            spans[i] = Span{volume.object, t0, t1};
+        }
+
+        MediaSegment result;
+        for (int i = 0; i < count && result.transmittance > 0.0f; ++i) {
+            const MediaSegment s = IntegrateMedium<Features, Path>(spans[i].object->medium, spans[i].object, ray,
+                                                                   spans[i].t0, spans[i].t1, lights, rng);
+            result.scattered += s.scattered * result.transmittance;
+            result.transmittance *= s.transmittance;
+        }
+        if (scene->medium.kind != MediumKind::None) {
+            const MediaSegment s = IntegrateMedium<Features, Path>(scene->medium, nullptr, ray, 0.0f, tEnd, lights, rng);
+            result.scattered = s.scattered + result.scattered * s.transmittance;
+            result.transmittance *= s.transmittance;
+        }
+        return result;
+    }
+
+    // Stretch [t0, t1] of the ray inside a volume object, clipped to tEnd.
+    static bool VolumeSpan(const FrameVolume& volume, const Ray& ray, float tEnd, float& t0, float& t1) {
+        if (volume.bounded) {
+            const float org[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+            const float inv[3] = {1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z};
+            float tBox = 0.0f;
+            if (!BvhSlabTest(volume.box, org, inv, tEnd, tBox)) return false;
+        }
+        const Object* object = volume.object;
+        if (object->ContainsPoint(ray.origin)) {
+            t0 = 0.0f;
+        } else {
+            const HitResult entry = object->Intersect(ray);
+            if (!entry.hit || entry.t >= tEnd) return false;
+            t0 = entry.t;
+        }
+        const HitResult exit = object->Intersect(Ray::FromUnit(ray.At(t0), ray.direction));
+        t1 = exit.hit ? std::min(tEnd, t0 + exit.t) : tEnd;
+        return t1 > t0;
+    }
+
+    // One medium between t0 and t1 (the owner's frame places heterogeneous
+    // density; nullptr for the scene medium). Homogeneous media have an
+    // analytic transmittance and take volumeSamples in-scattering points
+    // distributed like the extinction, so each carries the same weight.
+    // Heterogeneous media are ray marched with a step that keeps about
+    // kStepDepth optical depth per step: long in thin regions, refined where
+    // the density rises, at most volumeMaxSteps steps (the last one takes
+    // the rest of the span), stopped once the ray is nearly opaque. Preview
+    // frames add the ambient term analytically.
+    template <unsigned Features, bool Path>
+    MediaSegment IntegrateMedium(const Medium& medium, const Object* owner, const Ray& ray, float t0, float t1,
+                                 const std::vector<const Object*>& lights, Rng& rng) {
+        MediaSegment result;
+        t1 = std::min(t1, medium.extent);
+        const float length = t1 - t0;
+        if (length <= 0.0f || medium.density <= 0.0f) return result;
+        const ColorF tint = ColorF::FromSrgb(medium.color) * medium.albedo;
+
+        if (medium.kind == MediumKind::Homogeneous) {
+            result.transmittance = std::exp(-medium.density * length);
+            const float extinguished = 1.0f - result.transmittance;
+            const int count = std::max(1, volumeSamples);
+            ColorF sum;
+            for (int i = 0; i < count; ++i) {
+                const float u = (static_cast<float>(i) + rng.NextFloat()) / static_cast<float>(count);
+                const float d = -std::log(1.0f - u * extinguished) / medium.density;
+                sum += InScattered<Features, Path>(ray.At(t0 + d), ray.direction, medium.anisotropy, lights, rng);
+            }
+            result.scattered = tint * sum * (extinguished / static_cast<float>(count));
+        } else {
+            constexpr float kStepDepth = 0.2f;
+            const int maxSteps = std::max(1, volumeMaxSteps);
+            const float minStep = length / static_cast<float>(maxSteps);
+            const float maxStep = std::max(minStep, 0.25f * length);
+            const float jitter = rng.NextFloat();
+            float t = t0;
+            float step = maxStep;
+            uint64_t steps = 0;  // density evaluations, for the stats
+            int taken = 0;
+            bool refined = false;
+            while (t < t1) {
+                // the last allowed step takes the rest of the span, so the
+                // whole span is always integrated
+                const bool last = taken + 1 >= maxSteps;
+                step = last ? t1 - t : std::min(step, t1 - t);
+                const Vec3 x = ray.At(t + step * jitter);
+                const float sigma = medium.DensityAt(owner ? owner->GetTransform().PointToLocal(x, owner->position) : x);
+                ++steps;
+                // one refinement per step keeps it at two evaluations at most
+                if (!last && !refined && sigma * step > kStepDepth && step > minStep) {
+                    step = std::max(minStep, kStepDepth / sigma);
+                    refined = true;
+                    continue;
+                }
+                refined = false;
+                ++taken;
+                const float stepTransmittance = std::exp(-sigma * step);
+                if (stepTransmittance < 0.9999f) {
+                    result.scattered += InScattered<Features, Path>(x, ray.direction, medium.anisotropy, lights, rng) *
+                                        (result.transmittance * (1.0f - stepTransmittance));
+                }
+                result.transmittance *= stepTransmittance;
+                t += step;
+                if (last) break;
+                if (result.transmittance < 1e-3f) {
+                    result.transmittance = 0.0f;
                     break;
                 }
+                step = sigma > 0.0f ? std::clamp(kStepDepth / sigma, minStep, maxStep) : maxStep;
             }
-            if (occluded) continue;
+            if (RayCounters* counters = ThreadCounters()) counters->marchSteps += steps;
+            result.scattered = tint * result.scattered;
+        }
+        if constexpr (!Path) {
+            result.scattered += tint * (0.45f * (1.0f - result.transmittance));
+        }
+        return result;
+    }
 
-            float ndotl = std::max(0.0f, closestHit.normal.Dot(lightDir));
+    // Light arriving at x from the sun and the lights, weighted by the phase
+    // function towards -dir, per unit of scattering. The preview scales the
+    // phase so isotropic scattering matches its diffuse term and leaves the
+    // sun unshadowed, as ShadeSurface does; light paths are not attenuated by
+    // the media (single scattering).
+    template <unsigned Features, bool Path>
+    ColorF InScattered(const Vec3& x, const Vec3& dir, float g, const std::vector<const Object*>& lights, Rng& rng) const {
+        constexpr float kFourPi = 12.5663706f;
+        ColorF result;
+        const Vec3 sunDir = Vec3(0.3f, 0.8f, 0.5f).Normalized();
+        if constexpr (Path) {
+            if (!Occluded(Ray(x, sunDir), 1e30f, nullptr)) {
+                result += ColorF(0.35f, 0.35f, 0.35f) * (3.14159265f * PhaseHG(dir.Dot(sunDir), g));
+            }
+        } else {
+            result += ColorF(0.35f, 0.35f, 0.35f) * (kFourPi * PhaseHG(dir.Dot(sunDir), g));
+        }
 
-            float atten = 1.0f / (1.0f + 0.02f * dist);
-            float diff = ndotl * atten * 1.4f;
+        auto addLight = [&](const Object* light, float weight) {
+            const Vec3 toLight = light->position - x;
+            const float dist = toLight.Length();
+            const Vec3 l = toLight / std::max(1e-4f, dist);
+            if (Path || (Features & kShadeShadows) != 0) {
+                if (Occluded(Ray(x, l), dist, nullptr)) return;
+            }
+            const float phase = PhaseHG(dir.Dot(l), g) * weight;
+            if constexpr (Path) {
+                const ColorF intensity = ColorF::FromSrgb(light->color) * pathLightIntensity;
+                result += intensity * (phase / std::max(1e-8f, dist * dist));
+            } else {
+                const float atten = 1.4f / (1.0f + 0.02f * dist);
+                result += ColorF(atten, atten, atten) * (kFourPi * phase);
+            }
+        };
+        if constexpr ((Features & kShadeLightTree) != 0) {
+            // the tree ranks lights by a surface normal; a medium point has
+            // none, so one light is picked uniformly
+            const size_t count = lights.size();
+            const size_t pick = std::min(count - 1, static_cast<size_t>(rng.NextFloat() * static_cast<float>(count)));
+            addLight(lights[pick], static_cast<float>(count));
+        } else if constexpr ((Features & kShadeLights) != 0) {
+            for (const Object* light : lights) addLight(light, 1.0f);
+        } else {
+            (void)addLight;
+            (void)lights;
+            (void)rng;
+        }
+        return result;
+    }
 
-            r += obj->color.r * diff;
-            g += obj->color.g * diff;
-            b += obj->color.b * diff;
+    // Unbiased path tracer: next-event estimation at diffuse vertices,
+    // cosine-weighted continuation, mirror and Fresnel dielectric sampling for
+    // specular surfaces, Russian roulette after the third bounce.
+    //
+    // With kShadeSpectral the path carries kHeroWavelengths wavelengths (hero
+    // wavelength sampling) and dielectrics use Object::IndexAt. A dispersive
+    // refraction keeps only the hero wavelength, scaled by kHeroWavelengths.
+    // The first hit and its albedo come from the primary packet. With
+    // kShadeMedia every segment is attenuated by the media it crosses and
+    // picks up their single-scattered light; paths never scatter inside them.
+    template <unsigned Features>
+    ColorF TracePath(Ray ray, HitResult hit, const ColorF& firstAlbedo, const std::vector<const Object*>& lights,
+                     Rng& rng) {
+        constexpr bool Spectral = (Features & kShadeSpectral) != 0;
+        using Carrier = std::conditional_t<Spectral, Spectrum4, ColorF>;
+
+        float lambda[kHeroWavelengths] = {587.6f, 587.6f, 587.6f, 587.6f};
+        if constexpr (Spectral) {
+            SampleHeroWavelengths(rng.NextFloat(), lambda);
         }
+        auto lift = [&lambda](const ColorF& c) -> Carrier {
+            if constexpr (Spectral) {
+                return RgbToSpectrum(c, lambda);
+            } else {
+                (void)lambda;
+                return c;
+            }
+        };
+
+        const Carrier background = lift(ColorF::FromSrgb(dr4::Color(15, 17, 28)));
+        Carrier radiance;
+        Carrier throughput = lift(ColorF(1.0f, 1.0f, 1.0f));
+        bool specularBounce = true;
+        bool heroOnly = false;
+
+        for (int depth = 0; depth < pathMaxDepth; ++depth) {
+            if (depth > 0) hit = FindClosestHit(ray);
+            if constexpr ((Features & kShadeMedia) != 0) {
+                const float tEnd = hit.hit ? hit.t : std::numeric_limits<float>::infinity();
+                const MediaSegment media = TraceMedia<Features, true>(ray, tEnd, lights, rng);
+                radiance += throughput * lift(media.scattered);
+                throughput *= media.transmittance;
+                if (throughput.IsBlack()) break;
+            }
+            if (!hit.hit) {
+                radiance += throughput * background;
+                break;
+            }
+
+            const Object* obj = hit.object;
+            if constexpr ((Features & kShadeLights) != 0) {
+                if (obj->isLightSource) {
+                    // after a diffuse bounce the light was already counted by SampleDirect
+                    if (specularBounce) radiance += throughput * lift(LightRadiance(obj));
+                    break;
+                }
+            }
+
+            const bool entering = hit.normal.Dot(ray.direction) < 0.0f;
+            const Vec3 n = entering ? hit.normal : -hit.normal;
+            const Carrier albedo = lift(depth == 0 ? firstAlbedo : SurfaceAlbedo(hit));
+            const float cosI = -n.Dot(ray.direction);
+            Vec3 origin;
+            Vec3 dir;
+
+            if (obj->refractiveIndex > 1.0f) {
+                const bool dispersive = Spectral && !heroOnly && obj->IsDispersive();
+                const float ior = Spectral ? obj->IndexAt(lambda[0]) : obj->refractiveIndex;
+                const float eta = entering ? 1.0f / ior : ior;
+                float sin2T = 0.0f;
+                const float fresnel = Fresnel(cosI, eta, entering, sin2T);
+                if (rng.NextFloat() < fresnel) {
+                    dir = ray.direction + n * (2.0f * cosI);
+                    origin = hit.point + n * 0.001f;
+                    if constexpr (Spectral) {
+                        if (dispersive) {
+                            for (int i = 1; i < kHeroWavelengths; ++i) {
+                                float iorI = obj->IndexAt(lambda[i]);
+                                float sin2TI = 0.0f;
+                                throughput.v[i] *= Fresnel(cosI, entering ? 1.0f / iorI : iorI, entering, sin2TI) / fresnel;
+                            }
+                        }
+                    }
+                } else {
+                    float cosT = std::sqrt(1.0f - sin2T);
+                    dir = ray.direction * eta + n * (eta * cosI - cosT);
+                    origin = hit.point - n * 0.001f;
+                    throughput *= albedo;
+                    if constexpr (Spectral) {
+                        if (dispersive) {
+                            throughput.v[0] *= static_cast<float>(kHeroWavelengths);
+                            for (int i = 1; i < kHeroWavelengths; ++i) throughput.v[i] = 0.0f;
+                            heroOnly = true;
+                        }
+                    }
+                }
+                specularBounce = true;
+            } else if (obj->reflectivity > 0.0f && rng.NextFloat() < obj->reflectivity) {
+                dir = ray.direction + n * (2.0f * cosI);
+                origin = hit.point + n * 0.001f;
+                specularBounce = true;
+            } else {
+                radiance += throughput * albedo * lift(SampleDirect<Features>(hit, n, lights, rng));
 
-        r = std::min(255.0f, r);
-        g = std::min(255.0f, g);
-        b = std::min(255.0f, b);
+                float r1 = rng.NextFloat();
+                float r2 = rng.NextFloat();
+                float sinTheta = std::sqrt(r1);
+                float phi = 6.2831853f * r2;
+                Vec3 t, b;
+                OrthonormalBasis(n, t, b);
+                dir = t * (std::cos(phi) * sinTheta) + b * (std::sin(phi) * sinTheta) +
+                      n * std::sqrt(std::max(0.0f, 1.0f - r1));
+                origin = hit.point + n * 0.001f;
+                throughput *= albedo;
+                specularBounce = false;
+            }
+
+            if (depth >= 3) {
+                float survive = std::min(0.95f, throughput.MaxComponent());
+                if (rng.NextFloat() >= survive) break;
+                throughput *= 1.0f / survive;
+            }
+            if (throughput.IsBlack()) break;
+            ray = Ray(origin, dir);
+        }
 
-        return dr4::Color(static_cast<uint8_t>(r),
-                          static_cast<uint8_t>(g),
-                          static_cast<uint8_t>(b));
+        if constexpr (Spectral) {
+            return SpectrumToRgb(radiance, lambda);
+        } else {
+            return radiance;
+        }
     }
 
     void Render(dr4::Image* image) {
@@ -108,53 +841,409 @@ public:
         const int height = static_cast<int>(image->GetHeight());
         if (width <= 0 || height <= 0) return;
 
-        
-        std::vector<const Object*> lights;
-        lights.reserve(scene->objects.size());
+        const uint64_t allocationsBefore = HeapAllocationCount();
+        const auto renderStart = std::chrono::steady_clock::now();
+        if (rayCounters.size() != threadPool.WorkerCount()) {
+            rayCounters.resize(threadPool.WorkerCount());
+        }
+        for (RayCounters& counters : rayCounters) counters = RayCounters();
+        threadPool.ResetTiming();
+
+        // top level of the acceleration structure: rebuilt every frame, since
+        // the UI edits objects in place; instances and meshes bring their own
+        // bottom level
+        sceneBvh.Build(scene->objects);
+        sceneBvhReady = true;
+
+        // per-frame buffers are members and keep their capacity, so a frame
+        // of unchanged size allocates nothing
+        frameLights.clear();
+        frameVolumes.clear();
+        const bool cullTiles = tileCulling && scene->objects.size() <= kTileCullMaxObjects;
+        objectBoxes.clear();
         for (auto& o : scene->objects) {
-            if (o->isLightSource) lights.push_back(o.get());
+            if (o->isLightSource) frameLights.push_back(o.get());
+            // boxes are read here, since GetBoundingBox is not thread safe
+            Vec3 min, max;
+            if (cullTiles || o->IsVolume()) o->GetBoundingBox(min, max);
+            if (cullTiles) objectBoxes.push_back(ObjectBox{min, max, o->IsBounded(), o->IsVolume()});
+            if (o->IsVolume()) {
+                frameVolumes.push_back(FrameVolume{o.get(), BvhNode{{min.x, min.y, min.z}, 0, {max.x, max.y, max.z}, 0},
+                                                   o->IsBounded()});
+            }
         }
+        if (tileCandidates.size() != threadPool.WorkerCount()) {
+            tileCandidates.resize(threadPool.WorkerCount());
+        }
+        for (std::vector<uint32_t>& list : tileCandidates) list.reserve(objectBoxes.size());
+        const bool useTree = !frameLights.empty() && UsesLightTree(frameLights.size());
+        if (useTree) {
+            lightTree.Build(frameLights);
+        }
+        const uint64_t renderCount = frameCounter++;
 
-        
-        std::vector<dr4::Color> buffer(static_cast<size_t>(width) * static_cast<size_t>(height));
-
-        const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
-        const unsigned workers = std::min<unsigned>(hw, static_cast<unsigned>(height));
-        const int chunkRows = 8;
-        std::atomic<int> nextY{0};
-
-        auto workerFn = [&]() {
-            while (true) {
-                int y0 = nextY.fetch_add(chunkRows, std::memory_order_relaxed);
-                if (y0 >= height) break;
-                int y1 = std::min(height, y0 + chunkRows);
+        bool hasAreaLights = false;
+        for (const Object* light : frameLights) {
+            if (light->GetEmitterRadius() > 0.0f) hasAreaLights = true;
+        }
+        const bool pathTrace = integrator == Integrator::PathTrace;
+        const bool cameraMoved = CameraMoved();
+
+        // while the camera moves the preview drops shadows; the first frame
+        // after it stops is a full one and restarts the accumulation
+        const bool previousReduced = lastFrameReduced;
+        lastFrameReduced = !pathTrace && cameraMoved && !navigationShadows && renderCount > 0;
+        unsigned features = 0;
+        if (!frameLights.empty()) features |= kShadeLights;
+        if (useTree) features |= kShadeLightTree;
+        if (!lastFrameReduced) {
+            features |= kShadeShadows;
+            if (softShadows && shadowSamples > 0 && hasAreaLights) features |= kShadeSoftShadows;
+        }
+        if (previewReflections && maxBounces > 1) features |= kShadeSecondary;
+        if (!frameVolumes.empty() || scene->medium.kind != MediumKind::None) features |= kShadeMedia;
+        if (spectral) features |= kShadeSpectral;
+        const PixelKernel kernel = pathTrace ? PathKernelFor(features & kPathFeatureMask)
+                                             : PreviewKernelFor(features & kPreviewFeatureMask);
+
+        lastFrameStochastic = pathTrace || (features & (kShadeLightTree | kShadeSoftShadows | kShadeMedia)) != 0;
+        const auto frameStart = std::chrono::steady_clock::now();
+
+        const size_t pixelCount = static_cast<size_t>(width) * static_cast<size_t>(height);
+        gbuffer.Resize(width, height);
+
+        if (!progressive || !lastFrameStochastic || cameraMoved || previousReduced ||
+            accum.size() != pixelCount * 3) {
+            ResetAccumulation();
+        }
+        if (accumulatedFrames == 0) {
+            accum.assign(pixelCount * 3, 0.0f);
+        }
+        resolved.resize(pixelCount * 3);
+        SaveCameraState();
+        const uint32_t sampleIndex = static_cast<uint32_t>(accumulatedFrames);
+        const float invFrames = 1.0f / static_cast<float>(accumulatedFrames + 1);
+        const RayGenerator rayGen = camera->GetRayGenerator(static_cast<float>(width), static_cast<float>(height));
+
+        threadPool.ParallelFor(height, 8, [&](int y0, int y1) {
+            ThreadCounters()->primaryRays += static_cast<uint64_t>(y1 - y0) * static_cast<uint64_t>(width);
+            std::vector<uint32_t>& tileList = tileCandidates[ThreadPool::CurrentWorkerIndex()];
+            // tiles of the row band: primary rays test only the objects
+            // whose boxes reach into the tile's frustum, unless too many do
+            for (int tx0 = 0; tx0 < width; tx0 += kTileWidth) {
+                const int tx1 = std::min(width, tx0 + kTileWidth);
+                const std::vector<uint32_t>* candidates = nullptr;
+                if (cullTiles) {
+                    TileCandidates(rayGen, tx0, y0, tx1, y1, tileList);
+                    if (tileList.size() <= kMaxTileCandidates) candidates = &tileList;
+                }
                 for (int y = y0; y < y1; ++y) {
                     size_t rowOff = static_cast<size_t>(y) * static_cast<size_t>(width);
-                    for (int x = 0; x < width; ++x) {
-                        Ray ray = camera->GetRay(x + 0.5f, y + 0.5f,
-                                                 static_cast<float>(width), static_cast<float>(height));
-                        buffer[rowOff + static_cast<size_t>(x)] = TraceRay(ray, lights);
+                    // primary rays are generated kLanes pixels at a time
+                    for (int x0 = tx0; x0 < tx1; x0 += Float8::kLanes) {
+                        const int lanes = std::min(Float8::kLanes, tx1 - x0);
+                        Rng rngs[Float8::kLanes];
+                        alignas(32) float sx[Float8::kLanes];
+                        alignas(32) float sy[Float8::kLanes];
+                        for (int i = 0; i < Float8::kLanes; ++i) {
+                            // path tracing jitters the camera ray for antialiasing
+                            float jx = 0.5f, jy = 0.5f;
+                            if (i < lanes) {
+                                rngs[i] = Rng(rowOff + static_cast<size_t>(x0 + i), sampleIndex, frameIndex);
+                                if (pathTrace) {
+                                    jx = rngs[i].NextFloat();
+                                    jy = rngs[i].NextFloat();
+                                }
+                            }
+                            sx[i] = static_cast<float>(x0 + i) + jx;
+                            sy[i] = static_cast<float>(y) + jy;
+                        }
+                        alignas(32) float dx[Float8::kLanes];
+                        alignas(32) float dy[Float8::kLanes];
+                        alignas(32) float dz[Float8::kLanes];
+                        rayGen.Directions(Float8::Load(sx), Float8::Load(sy)).Store(dx, dy, dz);
+
+                        // primary hits first, so their textures are evaluated as one batch
+                        Ray rays[Float8::kLanes];
+                        HitResult hits[Float8::kLanes];
+                        ColorF albedos[Float8::kLanes];
+                        for (int i = 0; i < lanes; ++i) {
+                            rays[i] = Ray::FromUnit(rayGen.origin, Vec3(dx[i], dy[i], dz[i]));
+                            hits[i] = FindPrimaryHit(rays[i], &gbuffer.samples[rowOff + static_cast<size_t>(x0 + i)], candidates);
+                        }
+                        SurfaceAlbedos(hits, lanes, albedos);
+
+                        for (int i = 0; i < lanes; ++i) {
+                            size_t idx = rowOff + static_cast<size_t>(x0 + i);
+                            ColorF c = (this->*kernel)(rays[i], hits[i], albedos[i], frameLights, rngs[i]);
+                            float* acc = &accum[idx * 3];
+                            acc[0] += c.r;
+                            acc[1] += c.g;
+                            acc[2] += c.b;
+                            float* out = &resolved[idx * 3];
+                            out[0] = acc[0] * invFrames;
+                            out[1] = acc[1] * invFrames;
+                            out[2] = acc[2] * invFrames;
+                        }
                     }
                 }
             }
-        };
+        });
 
-        std::vector<std::thread> threads;
-        threads.reserve(workers > 0 ? workers - 1 : 0);
-        for (unsigned i = 1; i < workers; ++i) {
-            threads.emplace_back(workerFn);
+        ++accumulatedFrames;
+        lastFrameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+        lastFrameSamples = pixelCount;
+
+        lastDenoiseSeconds = 0.0;
+        lastFrameDenoised = false;
+        if (denoise && lastFrameStochastic && accumulatedFrames <= denoiseMaxFrames) {
+            const auto denoiseStart = std::chrono::steady_clock::now();
+            denoiser.Apply(resolved, gbuffer, accumulatedFrames, 1.0f, threadPool);
+            lastDenoiseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - denoiseStart).count();
+            lastFrameDenoised = true;
         }
-        workerFn(); 
-        for (auto& t : threads) {
-            if (t.joinable()) t.join();
+
+        lastAntialiasSeconds = 0.0;
+        if (antialias && !pathTrace) {
+            const auto aaStart = std::chrono::steady_clock::now();
+            antialiaser.Apply(resolved, gbuffer, 1.0f, threadPool);
+            lastAntialiasSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - aaStart).count();
         }
 
+        display.resize(pixelCount);
+        threadPool.ParallelFor(height, 16, [&](int y0, int y1) {
+            const size_t begin = static_cast<size_t>(y0) * static_cast<size_t>(width);
+            const size_t end = static_cast<size_t>(y1) * static_cast<size_t>(width);
+            EncodeSrgb(&resolved[begin * 3], end - begin, &display[begin]);
+        });
+
         for (int y = 0; y < height; ++y) {
             size_t rowOff = static_cast<size_t>(y) * static_cast<size_t>(width);
             for (int x = 0; x < width; ++x) {
-                image->SetPixel(x, y, buffer[rowOff + static_cast<size_t>(x)]);
+                image->SetPixel(x, y, display[rowOff + static_cast<size_t>(x)]);
+            }
+        }
+
+        RayCounters total;
+        for (const RayCounters& counters : rayCounters) total.Add(counters);
+        lastStats.primaryRays = total.primaryRays;
+        lastStats.secondaryRays = total.closestHitRays > total.primaryRays ? total.closestHitRays - total.primaryRays : 0;
+        lastStats.shadowRays = total.shadowRays;
+        lastStats.intersectionTests = total.intersectionTests;
+        lastStats.marchSteps = total.marchSteps;
+        lastStats.traceSeconds = lastFrameSeconds;
+        lastStats.frameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+        lastStats.threads = threadPool.WorkerCount();
+        const double capacity = threadPool.ParallelSeconds() * static_cast<double>(threadPool.WorkerCount());
+        lastStats.threadUtilization = capacity > 0.0 ? std::min(1.0, threadPool.BusySeconds() / capacity) : 0.0;
+        lastFrameAllocations = HeapAllocationCount() - allocationsBefore;
+        sceneBvhReady = false;
+    }
+
+    // Progressive mode averages every frame into an accumulation buffer until
+    // the camera moves or the scene is edited (callers report edits here).
+    void ResetAccumulation() {
+        accumulatedFrames = 0;
+    }
+
+    int GetAccumulatedFrames() const { return accumulatedFrames; }
+
+    // True when another Render call would not improve the image.
+    bool IsConverged() const {
+        if (lastFrameReduced) return false;
+        const int limit = integrator == Integrator::PathTrace ? pathMaxFrames : maxAccumulatedFrames;
+        return !progressive || !lastFrameStochastic || accumulatedFrames >= limit;
+    }
+
+    double GetLastFrameSeconds() const { return lastFrameSeconds; }
+
+    // Cost of the denoise stage in the last frame, 0 if it did not run.
+    double GetLastDenoiseSeconds() const { return lastDenoiseSeconds; }
+    bool WasLastFrameDenoised() const { return lastFrameDenoised; }
+    double GetLastAntialiasSeconds() const { return lastAntialiasSeconds; }
+
+    // Ray counts, intersection tests, timings and thread utilization of the last Render call.
+    const RenderStats& GetLastStats() const { return lastStats; }
+
+    // Heap allocations made by the last Render call; 0 in steady state.
+    uint64_t GetLastFrameAllocations() const { return lastFrameAllocations; }
+
+    // Camera samples (one per pixel per frame) traced per second in the last frame.
+    double GetSamplesPerSecond() const {
+        return lastFrameSeconds > 0.0 ? static_cast<double>(lastFrameSamples) / lastFrameSeconds : 0.0;
+    }
+
+    // Index into scene->objects hit by the primary ray of pixel (x, y) in the
+    // last rendered frame, -1 for background or outside the frame.
+    int GetObjectIdAt(int x, int y) const {
+        const GBufferSample* sample = gbuffer.At(x, y);
+        return sample ? sample->objectId : -1;
+    }
+
+    const GBuffer& GetGBuffer() const { return gbuffer; }
+
+    Object* PickObject(int x, int y) const {
+        if (!scene) return nullptr;
+        int id = GetObjectIdAt(x, y);
+        if (id < 0 || id >= static_cast<int>(scene->objects.size())) return nullptr;
+        return scene->objects[static_cast<size_t>(id)].get();
+    }
+
+    std::vector<Object*> PickObjectsInRect(int x0, int y0, int x1, int y1) const {
+        std::vector<Object*> picked;
+        if (!scene || gbuffer.width <= 0 || gbuffer.height <= 0) return picked;
+
+        if (x0 > x1) std::swap(x0, x1);
+        if (y0 > y1) std::swap(y0, y1);
+        x0 = std::max(0, x0);
+        y0 = std::max(0, y0);
+        x1 = std::min(gbuffer.width - 1, x1);
+        y1 = std::min(gbuffer.height - 1, y1);
+
+        const int objectCount = static_cast<int>(scene->objects.size());
+        std::vector<char> seen(static_cast<size_t>(objectCount), 0);
+        for (int y = y0; y <= y1; ++y) {
+            const GBufferSample* row = gbuffer.At(0, y);
+            for (int x = x0; x <= x1; ++x) {
+                int id = row[x].objectId;
+                if (id < 0 || id >= objectCount || seen[static_cast<size_t>(id)]) continue;
+                seen[static_cast<size_t>(id)] = 1;
+                picked.push_back(scene->objects[static_cast<size_t>(id)].get());
             }
         }
+        return picked;
+    }
+
+private:
+    using PixelKernel = ColorF (RayTracer::*)(const Ray&, const HitResult&, const ColorF&,
+                                              const std::vector<const Object*>&, Rng&);
+
+    LightTree lightTree;
+    uint64_t frameCounter = 0;
+    std::vector<float> accum;
+    int accumulatedFrames = 0;
+    bool lastFrameStochastic = false;
+    bool lastFrameReduced = false;
+    double lastFrameSeconds = 0.0;
+    size_t lastFrameSamples = 0;
+    double lastDenoiseSeconds = 0.0;
+    bool lastFrameDenoised = false;
+    double lastAntialiasSeconds = 0.0;
+    uint64_t lastFrameAllocations = 0;
+    RenderStats lastStats;
+    mutable std::vector<RayCounters> rayCounters;  // one per render thread, see ThreadCounters()
+    Camera lastCamera;
+    std::vector<const Object*> frameLights;  // light sources of the current frame
+    std::vector<FrameVolume> frameVolumes;   // objects holding a medium, with their boxes
+    // World box of every object for the per-tile culling stage, read once
+    // per frame; empty when the stage is off
+    struct ObjectBox {
+        Vec3 min, max;
+        bool bounded;
+        bool volume;
+    };
+    std::vector<ObjectBox> objectBoxes;
+    std::vector<std::vector<uint32_t>> tileCandidates;  // one list per render thread
+    static constexpr int kTileWidth = 32;                // pixels; a tile is as tall as a row band
+    static constexpr size_t kTileCullMaxObjects = 256;   // above this the scene BVH is cheaper than culling
+    static constexpr size_t kMaxTileCandidates = 24;     // longer lists go through the scene BVH
+    // BVH over scene->objects, valid only inside Render; queries between
+    // frames (picking, optical analysis) scan the list, which may have changed
+    ObjectBvh sceneBvh;
+    bool sceneBvhReady = false;
+    std::vector<float> resolved;        // linear RGB after accumulation and post-processing
+    std::vector<dr4::Color> display;    // sRGB-encoded resolved
+    GBuffer gbuffer;
+    ThreadPool threadPool;
+
+    // Counters of the calling render thread; queries made outside Render
+    // (picking, optical analysis) land in slot 0 and are reset by the next frame.
+    RayCounters* ThreadCounters() const {
+        const unsigned index = ThreadPool::CurrentWorkerIndex();
+        return index < rayCounters.size() ? &rayCounters[index] : nullptr;
+    }
+
+    // Indices of the objects whose boxes reach into the frustum of the pixel
+    // rectangle [x0, x1) x [y0, y1), in increasing order. The frustum is
+    // the four planes through the camera and the rectangle's corner rays; a
+    // box is outside when its corner furthest along a plane's inward normal
+    // is behind that plane. Unbounded objects are always kept, volumes
+    // never (closest-hit queries skip them).
+    void TileCandidates(const RayGenerator& gen, int x0, int y0, int x1, int y1, std::vector<uint32_t>& out) const {
+        out.clear();
+        auto corner = [&gen](int x, int y) {
+            const float ndcX = 2.0f * static_cast<float>(x) * gen.invWidth - 1.0f;
+            const float ndcY = 1.0f - 2.0f * static_cast<float>(y) * gen.invHeight;
+            return gen.forward + gen.right * ndcX + gen.up * ndcY;
+        };
+        const Vec3 corners[4] = {corner(x0, y0), corner(x1, y0), corner(x1, y1), corner(x0, y1)};
+        const Vec3 center = corners[0] + corners[1] + corners[2] + corners[3];
+        Vec3 planes[4];
+        for (int i = 0; i < 4; ++i) {
+            Vec3 n = corners[i].Cross(corners[(i + 1) % 4]);
+            if (n.Dot(center) < 0.0f) n = -n;
+            planes[i] = n.Normalized();
+        }
+        for (size_t i = 0; i < objectBoxes.size(); ++i) {
+            const ObjectBox& box = objectBoxes[i];
+            if (box.volume) continue;
+            bool inside = true;
+            for (int p = 0; p < 4 && inside && box.bounded; ++p) {
+                const Vec3& n = planes[p];
+                const Vec3 far(n.x >= 0.0f ? box.max.x : box.min.x, n.y >= 0.0f ? box.max.y : box.min.y,
+                               n.z >= 0.0f ? box.max.z : box.min.z);
+                inside = n.Dot(far - gen.origin) >= -1e-3f;
+            }
+            if (inside) out.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    template <unsigned Features>
+    ColorF PreviewKernel(const Ray& ray, const HitResult& hit, const ColorF& albedo,
+                         const std::vector<const Object*>& lights, Rng& rng) {
+        return ShadeRay<Features>(ray, hit, albedo, lights, rng, 0);
+    }
+
+    template <unsigned Features>
+    ColorF PathKernel(const Ray& ray, const HitResult& hit, const ColorF& albedo,
+                      const std::vector<const Object*>& lights, Rng& rng) {
+        return TracePath<Features>(ray, hit, albedo, lights, rng);
+    }
+
+    template <unsigned... Masks>
+    static PixelKernel SelectPreviewKernel(unsigned features, std::integer_sequence<unsigned, Masks...>) {
+        static const PixelKernel table[] = {&RayTracer::PreviewKernel<Masks>...};
+        return table[features];
+    }
+
+    template <unsigned... Masks>
+    static PixelKernel SelectPathKernel(unsigned features, std::integer_sequence<unsigned, Masks...>) {
+        // only the light and spectral bits matter; the rest of the table repeats them
+        static const PixelKernel table[] = {&RayTracer::PathKernel<Masks & kPathFeatureMask>...};
+        return table[features];
+    }
+
+    static PixelKernel PreviewKernelFor(unsigned features) {
+        return SelectPreviewKernel(features, std::make_integer_sequence<unsigned, kPreviewFeatureMask + 1>());
+    }
+
+    static PixelKernel PathKernelFor(unsigned features) {
+        return SelectPathKernel(features, std::make_integer_sequence<unsigned, kPathFeatureMask + 1>());
+    }
+
+    bool CameraMoved() const {
+        auto same = [](const Vec3& a, const Vec3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; };
+        return !same(camera->position, lastCamera.position) || !same(camera->target, lastCamera.target) ||
+               !same(camera->up, lastCamera.up) || camera->fov != lastCamera.fov ||
+               camera->aspectRatio != lastCamera.aspectRatio;
+    }
+
+    void SaveCameraState() {
+        lastCamera.position = camera->position;
+        lastCamera.target = camera->target;
+        lastCamera.up = camera->up;
+        lastCamera.fov = camera->fov;
+        lastCamera.aspectRatio = camera->aspectRatio;
     }
 };
 
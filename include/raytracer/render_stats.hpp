@@ -0,0 +1,54 @@
+#ifndef RAYTRACER_RENDER_STATS_HPP
+#define RAYTRACER_RENDER_STATS_HPP
+
+#include <cstdint>
+
+namespace raytracer {
+
+// Counters of one render thread. Each thread owns a cache line, so counting
+// needs neither atomics nor locks; RayTracer sums them after the frame.
+struct alignas(64) RayCounters {
+    uint64_t primaryRays = 0;
+    uint64_t closestHitRays = 0;     // primary and secondary rays
+    uint64_t shadowRays = 0;
+    uint64_t intersectionTests = 0;  // Object::Intersect calls
+    uint64_t marchSteps = 0;         // see ThreadMarchSteps
+
+    void Add(const RayCounters& o) {
+        primaryRays += o.primaryRays;
+        closestHitRays += o.closestHitRays;
+        shadowRays += o.shadowRays;
+        intersectionTests += o.intersectionTests;
+        marchSteps += o.marchSteps;
+    }
+};
+
+// Field evaluations of iterative intersectors (sphere-traced SDF objects)
+// on the calling thread. Objects cannot reach RayTracer's counters, so they
+// add here and RayTracer moves the count into RayCounters after each query.
+inline uint64_t& ThreadMarchSteps() {
+    thread_local uint64_t steps = 0;
+    return steps;
+}
+
+// Totals of the last rendered frame.
+struct RenderStats {
+    uint64_t primaryRays = 0;
+    uint64_t secondaryRays = 0;      // reflections, refractions and path bounces
+    uint64_t shadowRays = 0;
+    uint64_t intersectionTests = 0;
+    uint64_t marchSteps = 0;         // SDF field evaluations and medium ray-marching steps
+    double frameSeconds = 0.0;       // whole Render call, post-processing included
+    double traceSeconds = 0.0;       // ray tracing only
+    unsigned threads = 1;
+    double threadUtilization = 0.0;  // busy share of the threads inside parallel sections, 0..1
+
+    uint64_t TotalRays() const { return primaryRays + secondaryRays + shadowRays; }
+    double RaysPerSecond() const {
+        return traceSeconds > 0.0 ? static_cast<double>(TotalRays()) / traceSeconds : 0.0;
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_RENDER_STATS_HPP
@@ -0,0 +1,70 @@
+#ifndef RAYTRACER_SAMPLING_HPP
+#define RAYTRACER_SAMPLING_HPP
+
+#include <algorithm>
+#include <cmath>
+#include "raytracer/random.hpp"
+#include "raytracer/vec3.hpp"
+
+namespace raytracer {
+
+constexpr int kMaxStratifiedSamples = 64;
+
+// Builds tangent vectors t, b so that (t, b, n) is orthonormal; n must be unit length.
+inline void OrthonormalBasis(const Vec3& n, Vec3& t, Vec3& b) {
+    float sign = std::copysign(1.0f, n.z);
+    float a = -1.0f / (sign + n.z);
+    float c = n.x * n.y * a;
+    t = Vec3(1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+    b = Vec3(c, sign + n.y * n.y * a, -n.y);
+}
+
+// Fills u and v with n points in [0, 1)^2 such that every row and every
+// column of the n x n grid holds exactly one point (N-rooks pattern). Each
+// point is still uniformly distributed, so estimators stay unbiased for any n.
+inline void StratifiedSamples2D(int n, Rng& rng, float* u, float* v) {
+    n = std::min(n, kMaxStratifiedSamples);
+    int perm[kMaxStratifiedSamples];
+    for (int i = 0; i < n; ++i) perm[i] = i;
+    for (int i = n - 1; i > 0; --i) {
+        int j = static_cast<int>(rng.NextUInt() % static_cast<uint32_t>(i + 1));
+        std::swap(perm[i], perm[j]);
+    }
+    const float inv = 1.0f / static_cast<float>(n);
+    for (int i = 0; i < n; ++i) {
+        u[i] = (static_cast<float>(i) + rng.NextFloat()) * inv;
+        v[i] = (static_cast<float>(perm[i]) + rng.NextFloat()) * inv;
+    }
+}
+
+// Samples a direction uniformly inside the cone of directions from point p
+// that hit the sphere (center, radius). dist receives the distance to the
+// visible side of the sphere along dir. Returns false if p is inside it.
+inline bool SampleSphereCap(const Vec3& p, const Vec3& center, float radius,
+                            float u1, float u2, Vec3& dir, float& dist) {
+    Vec3 toCenter = center - p;
+    float distSq = toCenter.LengthSquared();
+    float radiusSq = radius * radius;
+    if (distSq <= radiusSq) return false;
+
+    float centerDist = std::sqrt(distSq);
+    Vec3 w = toCenter / centerDist;
+    float cosMax = std::sqrt(std::max(0.0f, 1.0f - radiusSq / distSq));
+    float cosTheta = 1.0f - u1 * (1.0f - cosMax);
+    float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    float phi = 6.2831853f * u2;
+
+    Vec3 t, b;
+    OrthonormalBasis(w, t, b);
+    dir = t * (std::cos(phi) * sinTheta) + b * (std::sin(phi) * sinTheta) + w * cosTheta;
+
+    // nearest root of |p + dir * s - center| = radius
+    float proj = centerDist * cosTheta;
+    float disc = std::max(0.0f, proj * proj - distSq + radiusSq);
+    dist = proj - std::sqrt(disc);
+    return true;
+}
+
+} // namespace raytracer
+
+#endif // RAYTRACER_SAMPLING_HPP
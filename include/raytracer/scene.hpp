@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include "raytracer/medium.hpp"
 #include "raytracer/object.hpp"
 #include "raytracer/vec3.hpp"
 
@@ -12,6 +13,7 @@ namespace raytracer {
 class Scene {
 public:
     std::vector<std::unique_ptr<Object>> objects;
+    Medium medium;  // fills the whole scene, e.g. haze around the optical layout
 
     void AddObject(std::unique_ptr<Object> obj) {
         objects.push_back(std::move(obj));
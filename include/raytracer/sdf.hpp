@@ -0,0 +1,266 @@
+#ifndef RAYTRACER_SDF_HPP
+#define RAYTRACER_SDF_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "raytracer/object.hpp"
+#include "raytracer/render_stats.hpp"
+
+namespace raytracer {
+
+enum class SdfShape {
+    Sphere,    // size.x radius
+    Box,       // size = half extents
+    Torus,     // in the xz plane: size.x major, size.y minor radius
+    Capsule,   // along y: size.x radius, size.y half length of the axis
+    Cylinder,  // along y: size.x radius, size.y half height
+};
+
+inline const char* SdfShapeName(SdfShape shape) {
+    switch (shape) {
+        case SdfShape::Sphere: return "Sphere";
+        case SdfShape::Box: return "Box";
+        case SdfShape::Torus: return "Torus";
+        case SdfShape::Capsule: return "Capsule";
+        case SdfShape::Cylinder: return "Cylinder";
+    }
+    return "SDF";
+}
+
+// One built-in distance field placed at `center`. `rounding` rounds the
+// edges of boxes and cylinders without changing their outer size.
+struct SdfPrimitive {
+    SdfShape shape = SdfShape::Sphere;
+    Vec3 center;
+    Vec3 size = Vec3(1, 1, 1);
+    float rounding = 0.0f;
+
+    // Exact Euclidean distance, so every field is 1-Lipschitz.
+    template <typename T>
+    T Distance(const Vec3T<T>& point) const {
+        const Vec3T<T> p = point - Vec3T<T>(center);
+        const T r = T(rounding);
+        switch (shape) {
+            case SdfShape::Sphere:
+                return p.Length() - T(size.x);
+            case SdfShape::Box: {
+                const T qx = std::fabs(p.x) - T(size.x) + r;
+                const T qy = std::fabs(p.y) - T(size.y) + r;
+                const T qz = std::fabs(p.z) - T(size.z) + r;
+                const Vec3T<T> outside(std::max(qx, T(0)), std::max(qy, T(0)), std::max(qz, T(0)));
+                return outside.Length() + std::min(std::max(qx, std::max(qy, qz)), T(0)) - r;
+            }
+            case SdfShape::Torus: {
+                const T ring = std::sqrt(p.x * p.x + p.z * p.z) - T(size.x);
+                return std::sqrt(ring * ring + p.y * p.y) - T(size.y);
+            }
+            case SdfShape::Capsule: {
+                const T y = p.y - std::clamp(p.y, T(-size.y), T(size.y));
+                return std::sqrt(p.x * p.x + y * y + p.z * p.z) - T(size.x);
+            }
+            case SdfShape::Cylinder: {
+                const T dr = std::sqrt(p.x * p.x + p.z * p.z) - T(size.x) + r;
+                const T dy = std::fabs(p.y) - T(size.y) + r;
+                const T ox = std::max(dr, T(0)), oy = std::max(dy, T(0));
+                return std::sqrt(ox * ox + oy * oy) + std::min(std::max(dr, dy), T(0)) - r;
+            }
+        }
+        return std::numeric_limits<T>::max();
+    }
+
+    void GetBounds(Vec3& min, Vec3& max) const {
+        Vec3 half = size;
+        switch (shape) {
+            case SdfShape::Sphere: half = Vec3(size.x, size.x, size.x); break;
+            case SdfShape::Box: break;
+            case SdfShape::Torus: half = Vec3(size.x + size.y, size.y, size.x + size.y); break;
+            case SdfShape::Capsule: half = Vec3(size.x, size.y + size.x, size.x); break;
+            case SdfShape::Cylinder: half = Vec3(size.x, size.y, size.x); break;
+        }
+        min = center - half;
+        max = center + half;
+    }
+};
+
+enum class SdfOp {
+    Union,
+    Subtract,   // the field so far minus this primitive
+    Intersect,
+};
+
+// A primitive and how it joins the field built from the terms before it.
+// blend > 0 makes the operation smooth, with a fillet of about that size.
+struct SdfTerm {
+    SdfPrimitive primitive;
+    SdfOp op = SdfOp::Union;
+    float blend = 0.0f;
+};
+
+// Polynomial smooth minimum; moves the result at most k / 4 below min(a, b)
+// and, as a convex mix of the gradients, keeps the fields 1-Lipschitz.
+template <typename T>
+inline T SmoothMin(T a, T b, T k) {
+    if (k <= T(0)) return std::min(a, b);
+    const T h = std::max(k - std::fabs(a - b), T(0)) / k;
+    return std::min(a, b) - h * h * k * T(0.25);
+}
+
+// Shape given by a signed distance field: a list of built-in primitives
+// folded left to right with (smooth) union, subtraction and intersection.
+// Rays are sphere traced from where they enter the bounding box: each step
+// advances by the field value divided by the Lipschitz bound, a hit is a
+// value below a small fraction of HitEpsilon, and a ray that leaves the box
+// or runs out of steps misses. A ray starting inside the shape traces the
+// negated field to its exit. Steps are counted in ThreadMarchSteps.
+class Sdf : public ObjectImpl<Sdf> {
+public:
+    explicit Sdf(std::vector<SdfTerm> terms_ = {}, const std::string& name_ = "SDF") : ObjectImpl(name_) {
+        SetTerms(std::move(terms_));
+    }
+
+    const std::vector<SdfTerm>& Terms() const { return terms; }
+    int MaxSteps() const { return maxSteps; }
+    float Lipschitz() const { return lipschitz; }
+
+    void SetTerms(std::vector<SdfTerm> terms_) {
+        terms = std::move(terms_);
+        UpdateBounds();
+    }
+
+    void SetMaxSteps(int steps) { maxSteps = std::max(1, steps); }
+
+    // Only needed for fields steeper than a distance (all built-ins are 1).
+    void SetLipschitz(float bound) { lipschitz = std::max(1.0f, bound); }
+
+    // Field value at a point relative to the position.
+    template <typename T>
+    T Distance(const Vec3T<T>& p) const {
+        if (terms.empty()) return std::numeric_limits<T>::max();
+        T d = terms[0].primitive.Distance(p);
+        for (size_t i = 1; i < terms.size(); ++i) {
+            const SdfTerm& term = terms[i];
+            const T e = term.primitive.Distance(p);
+            const T k = T(term.blend);
+            switch (term.op) {
+                case SdfOp::Union: d = SmoothMin(d, e, k); break;
+                case SdfOp::Subtract: d = -SmoothMin(-d, e, k); break;
+                case SdfOp::Intersect: d = -SmoothMin(-d, -e, k); break;
+            }
+        }
+        return d;
+    }
+
+    template <typename T>
+    HitResultT<T> IntersectT(const RayT<T>& ray) const {
+        HitResultT<T> result;
+        const RayT<T> local = RayT<T>::FromUnit(ray.origin - Vec3T<T>(position), ray.direction);
+        T tEnter, tExit;
+        if (!RayBox(local, tEnter, tExit)) return result;
+
+        // a ray from inside the box starts past the self-hit distance, so
+        // one leaving the surface reads the side it is heading into
+        const T eps = HitEpsilon<T>() * T(0.1);
+        const T start = T(2) * HitEpsilon<T>();
+        T t = std::max(tEnter, start);
+        const T side = tEnter <= start && Distance(local.At(t)) < T(0) ? T(-1) : T(1);
+        const T invLipschitz = T(1) / T(lipschitz);
+        uint64_t steps = 0;
+        bool hit = false;
+        while (t <= tExit && steps < static_cast<uint64_t>(maxSteps)) {
+            const T d = side * Distance(local.At(t));
+            ++steps;
+            if (d < eps) {
+                hit = true;
+                break;
+            }
+            t += d * invLipschitz;
+        }
+        ThreadMarchSteps() += steps;
+        if (!hit) return result;
+
+        result.hit = true;
+        result.t = t;
+        result.point = ray.At(t);
+        result.normal = Gradient(local.At(t)).Normalized();
+        result.object = this;
+        return result;
+    }
+
+    void GetLocalBoundingBox(Vec3& min, Vec3& max) const override {
+        min = boundsMin + position;
+        max = boundsMax + position;
+    }
+
+    bool ContainsLocalPoint(const Vec3& point) const override {
+        return Distance(point - position) <= 0.0f;
+    }
+
+private:
+    std::vector<SdfTerm> terms;
+    Vec3 boundsMin, boundsMax;
+    int maxSteps = 128;
+    float lipschitz = 1.0f;
+
+    // Unions grow the box (smooth ones by the k / 4 bulge), intersections
+    // shrink it, subtractions leave it.
+    void UpdateBounds() {
+        boundsMin = boundsMax = Vec3(0, 0, 0);
+        if (terms.empty()) return;
+        terms[0].primitive.GetBounds(boundsMin, boundsMax);
+        for (size_t i = 1; i < terms.size(); ++i) {
+            const SdfTerm& term = terms[i];
+            Vec3 lo, hi;
+            term.primitive.GetBounds(lo, hi);
+            if (term.op == SdfOp::Union) {
+                const Vec3 pad(0.25f * term.blend, 0.25f * term.blend, 0.25f * term.blend);
+                boundsMin = Vec3(std::min(boundsMin.x, lo.x), std::min(boundsMin.y, lo.y), std::min(boundsMin.z, lo.z)) - pad;
+                boundsMax = Vec3(std::max(boundsMax.x, hi.x), std::max(boundsMax.y, hi.y), std::max(boundsMax.z, hi.z)) + pad;
+            } else if (term.op == SdfOp::Intersect) {
+                boundsMin = Vec3(std::max(boundsMin.x, lo.x), std::max(boundsMin.y, lo.y), std::max(boundsMin.z, lo.z));
+                boundsMax = Vec3(std::min(boundsMax.x, hi.x), std::min(boundsMax.y, hi.y), std::min(boundsMax.z, hi.z));
+                boundsMax = Vec3(std::max(boundsMax.x, boundsMin.x), std::max(boundsMax.y, boundsMin.y),
+                                 std::max(boundsMax.z, boundsMin.z));
+            }
+        }
+    }
+
+    template <typename T>
+    bool RayBox(const RayT<T>& ray, T& tEnter, T& tExit) const {
+        const T lo[3] = {T(boundsMin.x), T(boundsMin.y), T(boundsMin.z)};
+        const T hi[3] = {T(boundsMax.x), T(boundsMax.y), T(boundsMax.z)};
+        const T o[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+        const T d[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+        tEnter = T(0);
+        tExit = std::numeric_limits<T>::max();
+        for (int a = 0; a < 3; ++a) {
+            const T inv = T(1) / d[a];
+            T tn = (lo[a] - o[a]) * inv;
+            T tf = (hi[a] - o[a]) * inv;
+            if (tn > tf) std::swap(tn, tf);
+            tEnter = tn > tEnter ? tn : tEnter;
+            tExit = tf < tExit ? tf : tExit;
+        }
+        return tEnter <= tExit;
+    }
+
+    // Tetrahedral central differences: four field evaluations. The step is
+    // fixed per precision, not tied to HitEpsilon (1e-9 in double would
+    // cancel the differences away); float needs the larger one for its
+    // rounding, double can afford a smaller truncation error.
+    template <typename T>
+    Vec3T<T> Gradient(const Vec3T<T>& p) const {
+        const T h = std::is_same<T, float>::value ? T(1e-3) : T(1e-6);
+        const Vec3T<T> a(h, -h, -h), b(-h, -h, h), c(-h, h, -h), d(h, h, h);
+        const T fa = Distance(p + a), fb = Distance(p + b), fc = Distance(p + c), fd = Distance(p + d);
+        return (a * fa + b * fb + c * fc + d * fd) * (T(1) / (T(4) * h * h));
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_SDF_HPP
@@ -0,0 +1,233 @@
+#ifndef RAYTRACER_SIMD_HPP
+#define RAYTRACER_SIMD_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "raytracer/vec3.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RAYTRACER_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#define RAYTRACER_AVX 1
+#include <immintrin.h>
+#endif
+
+namespace raytracer {
+
+// 4 float lanes. Comparisons return lane masks (all bits set where true)
+// that feed Select, so per-lane decisions stay branch-free.
+struct alignas(16) Float4 {
+#if RAYTRACER_SSE
+    __m128 v;
+
+    Float4() : v(_mm_setzero_ps()) {}
+    Float4(__m128 v_) : v(v_) {}
+    Float4(float k) : v(_mm_set1_ps(k)) {}
+    Float4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)) {}
+
+    static Float4 Load(const float* p) { return _mm_loadu_ps(p); }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+    friend Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+    friend Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+    friend Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+    friend Float4 operator<(Float4 a, Float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+    friend Float4 operator>(Float4 a, Float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+    friend Float4 operator&(Float4 a, Float4 b) { return _mm_and_ps(a.v, b.v); }
+    friend Float4 operator|(Float4 a, Float4 b) { return _mm_or_ps(a.v, b.v); }
+
+    friend Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+    friend Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+    friend Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+    // truncation rounded down, for |a| < 2^31 (SSE2 has no floor)
+    friend Float4 Floor(Float4 a) {
+        const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+        return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f)));
+    }
+    // mask ? a : b
+    friend Float4 Select(Float4 mask, Float4 a, Float4 b) {
+        return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+    }
+    friend int MoveMask(Float4 mask) { return _mm_movemask_ps(mask.v); }
+    friend void ToInt(Float4 a, int32_t* out) { _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_cvttps_epi32(a.v)); }
+
+    float operator[](int i) const { alignas(16) float t[4]; _mm_store_ps(t, v); return t[i]; }
+#else
+    float v[4];
+
+    Float4() : v{0, 0, 0, 0} {}
+    Float4(float k) : v{k, k, k, k} {}
+    Float4(float a, float b, float c, float d) : v{a, b, c, d} {}
+
+    static Float4 Load(const float* p) { return Float4(p[0], p[1], p[2], p[3]); }
+    void Store(float* p) const { for (int i = 0; i < 4; ++i) p[i] = v[i]; }
+
+    template <typename Op>
+    static Float4 Map(Float4 a, Float4 b, Op op) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = op(a.v[i], b.v[i]); return r; }
+    static float MaskValue(bool m) { uint32_t bits = m ? 0xffffffffu : 0u; float f; std::memcpy(&f, &bits, 4); return f; }
+    static uint32_t Bits(float f) { uint32_t b; std::memcpy(&b, &f, 4); return b; }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x + y; }); }
+    friend Float4 operator-(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x - y; }); }
+    friend Float4 operator*(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x * y; }); }
+    friend Float4 operator/(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x / y; }); }
+    friend Float4 operator<(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return MaskValue(x < y); }); }
+    friend Float4 operator>(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return MaskValue(x > y); }); }
+    friend Float4 operator&(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return MaskValue(Bits(x) & Bits(y)); }); }
+    friend Float4 operator|(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return MaskValue(Bits(x) | Bits(y)); }); }
+
+    // like minps/maxps: the second operand when either is NaN
+    friend Float4 Min(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x < y ? x : y; }); }
+    friend Float4 Max(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x > y ? x : y; }); }
+    friend Float4 Sqrt(Float4 a) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = std::sqrt(a.v[i]); return r; }
+    friend Float4 Floor(Float4 a) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = std::floor(a.v[i]); return r; }
+    friend Float4 Select(Float4 mask, Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = Bits(mask.v[i]) ? a.v[i] : b.v[i]; return r; }
+    friend int MoveMask(Float4 mask) { int m = 0; for (int i = 0; i < 4; ++i) m |= (Bits(mask.v[i]) >> 31) << i; return m; }
+    friend void ToInt(Float4 a, int32_t* out) { for (int i = 0; i < 4; ++i) out[i] = static_cast<int32_t>(a.v[i]); }
+
+    float operator[](int i) const { return v[i]; }
+#endif
+    static constexpr int kLanes = 4;
+};
+
+// 8 float lanes: one AVX register, or two Float4 halves without AVX.
+struct alignas(32) Float8 {
+#if RAYTRACER_AVX
+    __m256 v;
+
+    Float8() : v(_mm256_setzero_ps()) {}
+    Float8(__m256 v_) : v(v_) {}
+    Float8(float k) : v(_mm256_set1_ps(k)) {}
+
+    static Float8 Load(const float* p) { return _mm256_loadu_ps(p); }
+    void Store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend Float8 operator+(Float8 a, Float8 b) { return _mm256_add_ps(a.v, b.v); }
+    friend Float8 operator-(Float8 a, Float8 b) { return _mm256_sub_ps(a.v, b.v); }
+    friend Float8 operator*(Float8 a, Float8 b) { return _mm256_mul_ps(a.v, b.v); }
+    friend Float8 operator/(Float8 a, Float8 b) { return _mm256_div_ps(a.v, b.v); }
+    friend Float8 operator<(Float8 a, Float8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+    friend Float8 operator>(Float8 a, Float8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+    friend Float8 operator&(Float8 a, Float8 b) { return _mm256_and_ps(a.v, b.v); }
+    friend Float8 operator|(Float8 a, Float8 b) { return _mm256_or_ps(a.v, b.v); }
+
+    friend Float8 Min(Float8 a, Float8 b) { return _mm256_min_ps(a.v, b.v); }
+    friend Float8 Max(Float8 a, Float8 b) { return _mm256_max_ps(a.v, b.v); }
+    friend Float8 Sqrt(Float8 a) { return _mm256_sqrt_ps(a.v); }
+    friend Float8 Floor(Float8 a) { return _mm256_floor_ps(a.v); }
+    friend Float8 Select(Float8 mask, Float8 a, Float8 b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+    friend int MoveMask(Float8 mask) { return _mm256_movemask_ps(mask.v); }
+    friend void ToInt(Float8 a, int32_t* out) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_cvttps_epi32(a.v)); }
+
+    float operator[](int i) const { alignas(32) float t[8]; _mm256_store_ps(t, v); return t[i]; }
+#else
+    Float4 lo, hi;
+
+    Float8() {}
+    Float8(Float4 lo_, Float4 hi_) : lo(lo_), hi(hi_) {}
+    Float8(float k) : lo(k), hi(k) {}
+
+    static Float8 Load(const float* p) { return Float8(Float4::Load(p), Float4::Load(p + 4)); }
+    void Store(float* p) const { lo.Store(p); hi.Store(p + 4); }
+
+    friend Float8 operator+(Float8 a, Float8 b) { return Float8(a.lo + b.lo, a.hi + b.hi); }
+    friend Float8 operator-(Float8 a, Float8 b) { return Float8(a.lo - b.lo, a.hi - b.hi); }
+    friend Float8 operator*(Float8 a, Float8 b) { return Float8(a.lo * b.lo, a.hi * b.hi); }
+    friend Float8 operator/(Float8 a, Float8 b) { return Float8(a.lo / b.lo, a.hi / b.hi); }
+    friend Float8 operator<(Float8 a, Float8 b) { return Float8(a.lo < b.lo, a.hi < b.hi); }
+    friend Float8 operator>(Float8 a, Float8 b) { return Float8(a.lo > b.lo, a.hi > b.hi); }
+    friend Float8 operator&(Float8 a, Float8 b) { return Float8(a.lo & b.lo, a.hi & b.hi); }
+    friend Float8 operator|(Float8 a, Float8 b) { return Float8(a.lo | b.lo, a.hi | b.hi); }
+
+    friend Float8 Min(Float8 a, Float8 b) { return Float8(Min(a.lo, b.lo), Min(a.hi, b.hi)); }
+    friend Float8 Max(Float8 a, Float8 b) { return Float8(Max(a.lo, b.lo), Max(a.hi, b.hi)); }
+    friend Float8 Sqrt(Float8 a) { return Float8(Sqrt(a.lo), Sqrt(a.hi)); }
+    friend Float8 Floor(Float8 a) { return Float8(Floor(a.lo), Floor(a.hi)); }
+    friend Float8 Select(Float8 mask, Float8 a, Float8 b) { return Float8(Select(mask.lo, a.lo, b.lo), Select(mask.hi, a.hi, b.hi)); }
+    friend int MoveMask(Float8 mask) { return MoveMask(mask.lo) | (MoveMask(mask.hi) << 4); }
+    friend void ToInt(Float8 a, int32_t* out) { ToInt(a.lo, out); ToInt(a.hi, out + 4); }
+
+    float operator[](int i) const { return i < 4 ? lo[i] : hi[i - 4]; }
+#endif
+    static constexpr int kLanes = 8;
+};
+
+// A single 3D vector in one aligned register (w lane unused, kept at 0).
+struct alignas(16) Vec4 {
+    Float4 v;
+
+    Vec4() {}
+    Vec4(Float4 v_) : v(v_) {}
+    Vec4(float x, float y, float z) : v(x, y, z, 0.0f) {}
+    explicit Vec4(const Vec3& a) : v(a.x, a.y, a.z, 0.0f) {}
+
+    Vec3 ToVec3() const {
+        alignas(16) float t[4];
+        v.Store(t);
+        return Vec3(t[0], t[1], t[2]);
+    }
+
+    Vec4 operator+(const Vec4& o) const { return v + o.v; }
+    Vec4 operator-(const Vec4& o) const { return v - o.v; }
+    Vec4 operator*(const Vec4& o) const { return v * o.v; }
+    Vec4 operator*(float k) const { return v * Float4(k); }
+
+    float Dot(const Vec4& o) const {
+        Float4 p = v * o.v;
+        return p[0] + p[1] + p[2];
+    }
+    float LengthSquared() const { return Dot(*this); }
+    // Zero vector stays zero; no branch on the length.
+    Vec4 Normalized() const {
+        float lenSq = LengthSquared();
+        float inv = lenSq > 1e-12f ? 1.0f / std::sqrt(lenSq) : 0.0f;
+        return *this * inv;
+    }
+};
+
+inline Vec4 Min(const Vec4& a, const Vec4& b) { return Min(a.v, b.v); }
+inline Vec4 Max(const Vec4& a, const Vec4& b) { return Max(a.v, b.v); }
+
+// N 3D vectors in structure-of-arrays layout, one vector per lane.
+template <typename F>
+struct Vec3Lanes {
+    F x, y, z;
+
+    Vec3Lanes() {}
+    Vec3Lanes(F x_, F y_, F z_) : x(x_), y(y_), z(z_) {}
+    explicit Vec3Lanes(const Vec3& a) : x(a.x), y(a.y), z(a.z) {}
+
+    Vec3Lanes operator+(const Vec3Lanes& o) const { return Vec3Lanes(x + o.x, y + o.y, z + o.z); }
+    Vec3Lanes operator-(const Vec3Lanes& o) const { return Vec3Lanes(x - o.x, y - o.y, z - o.z); }
+    Vec3Lanes operator*(F k) const { return Vec3Lanes(x * k, y * k, z * k); }
+
+    F Dot(const Vec3Lanes& o) const { return x * o.x + y * o.y + z * o.z; }
+    F LengthSquared() const { return Dot(*this); }
+    Vec3Lanes Cross(const Vec3Lanes& o) const {
+        return Vec3Lanes(y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x);
+    }
+    Vec3Lanes Normalized() const {
+        F lenSq = LengthSquared();
+        F inv = Select(lenSq > F(1e-12f), F(1.0f) / Sqrt(lenSq), F(0.0f));
+        return *this * inv;
+    }
+
+    void Store(float* xs, float* ys, float* zs) const {
+        x.Store(xs);
+        y.Store(ys);
+        z.Store(zs);
+    }
+
+    Vec3 Lane(int i) const { return Vec3(x[i], y[i], z[i]); }
+};
+
+using Vec3x4 = Vec3Lanes<Float4>;
+using Vec3x8 = Vec3Lanes<Float8>;
+
+} // namespace raytracer
+
+#endif // RAYTRACER_SIMD_HPP
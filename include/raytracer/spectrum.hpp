@@ -0,0 +1,117 @@
+#ifndef RAYTRACER_SPECTRUM_HPP
+#define RAYTRACER_SPECTRUM_HPP
+
+#include <algorithm>
+#include <cmath>
+#include "raytracer/color.hpp"
+
+namespace raytracer {
+
+constexpr int kHeroWavelengths = 4;
+constexpr float kLambdaMin = 380.0f;
+constexpr float kLambdaMax = 780.0f;
+
+// Values of a spectral quantity at the kHeroWavelengths wavelengths carried by one path.
+struct Spectrum4 {
+    float v[kHeroWavelengths];
+
+    Spectrum4() : v{0, 0, 0, 0} {}
+    explicit Spectrum4(float k) : v{k, k, k, k} {}
+
+    Spectrum4 operator+(const Spectrum4& o) const { Spectrum4 s; for (int i = 0; i < kHeroWavelengths; ++i) s.v[i] = v[i] + o.v[i]; return s; }
+    Spectrum4 operator*(const Spectrum4& o) const { Spectrum4 s; for (int i = 0; i < kHeroWavelengths; ++i) s.v[i] = v[i] * o.v[i]; return s; }
+    Spectrum4 operator*(float k) const { Spectrum4 s; for (int i = 0; i < kHeroWavelengths; ++i) s.v[i] = v[i] * k; return s; }
+
+    Spectrum4& operator+=(const Spectrum4& o) { for (int i = 0; i < kHeroWavelengths; ++i) v[i] += o.v[i]; return *this; }
+    Spectrum4& operator*=(const Spectrum4& o) { for (int i = 0; i < kHeroWavelengths; ++i) v[i] *= o.v[i]; return *this; }
+    Spectrum4& operator*=(float k) { for (int i = 0; i < kHeroWavelengths; ++i) v[i] *= k; return *this; }
+
+    float MaxComponent() const { return std::max(std::max(v[0], v[1]), std::max(v[2], v[3])); }
+    bool IsBlack() const { return MaxComponent() <= 0.0f; }
+};
+
+// Hero wavelength plus kHeroWavelengths - 1 companions spaced evenly over the
+// visible range, so every wavelength is still marginally uniform.
+inline void SampleHeroWavelengths(float u, float* lambda) {
+    const float range = kLambdaMax - kLambdaMin;
+    const float hero = u * range;
+    for (int i = 0; i < kHeroWavelengths; ++i) {
+        float offset = hero + range * static_cast<float>(i) / static_cast<float>(kHeroWavelengths);
+        if (offset >= range) offset -= range;
+        lambda[i] = kLambdaMin + offset;
+    }
+}
+
+inline float SmoothStep(float x, float edge0, float edge1) {
+    float t = std::min(1.0f, std::max(0.0f, (x - edge0) / (edge1 - edge0)));
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// Linear RGB -> reflectance/emission spectrum. The three bands sum to one at
+// every wavelength, so white stays flat and the mapping is linear.
+inline float RgbToSpectrum(const ColorF& c, float lambda) {
+    float blue = 1.0f - SmoothStep(lambda, 480.0f, 510.0f);
+    float red = SmoothStep(lambda, 570.0f, 600.0f);
+    float green = 1.0f - blue - red;
+    return c.r * red + c.g * green + c.b * blue;
+}
+
+inline Spectrum4 RgbToSpectrum(const ColorF& c, const float* lambda) {
+    Spectrum4 s;
+    for (int i = 0; i < kHeroWavelengths; ++i) s.v[i] = RgbToSpectrum(c, lambda[i]);
+    return s;
+}
+
+// CIE 1931 colour matching functions, multi-lobe Gaussian fit of Wyman et al.
+inline void CieMatching(float lambda, float& x, float& y, float& z) {
+    auto g = [lambda](float mu, float s1, float s2) {
+        float t = (lambda - mu) / (lambda < mu ? s1 : s2);
+        return std::exp(-0.5f * t * t);
+    };
+    x = 1.056f * g(599.8f, 37.9f, 31.0f) + 0.362f * g(442.0f, 16.0f, 26.7f) - 0.065f * g(501.1f, 20.4f, 26.2f);
+    y = 0.821f * g(568.8f, 46.9f, 40.5f) + 0.286f * g(530.9f, 16.3f, 31.1f);
+    z = 1.217f * g(437.0f, 11.8f, 36.0f) + 0.681f * g(459.0f, 26.0f, 13.8f);
+}
+
+inline ColorF XyzToLinearRgb(float x, float y, float z) {
+    return ColorF( 3.2404542f * x - 1.5371385f * y - 0.4985314f * z,
+                  -0.9692660f * x + 1.8760108f * y + 0.0415560f * z,
+                   0.0556434f * x - 0.2040259f * y + 1.0572252f * z);
+}
+
+// RGB of a flat unit spectrum; dividing by it maps equal-energy white to (1, 1, 1).
+inline const ColorF& SpectralWhite() {
+    static const ColorF white = [] {
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+        for (float l = kLambdaMin + 0.5f; l < kLambdaMax; l += 1.0f) {
+            float cx, cy, cz;
+            CieMatching(l, cx, cy, cz);
+            x += cx;
+            y += cy;
+            z += cz;
+        }
+        return XyzToLinearRgb(x, y, z);
+    }();
+    return white;
+}
+
+// Monte Carlo estimate of the RGB colour of a path carrying radiance L at
+// wavelengths lambda, each sampled with density 1 / (kLambdaMax - kLambdaMin).
+inline ColorF SpectrumToRgb(const Spectrum4& L, const float* lambda) {
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+    for (int i = 0; i < kHeroWavelengths; ++i) {
+        float cx, cy, cz;
+        CieMatching(lambda[i], cx, cy, cz);
+        x += L.v[i] * cx;
+        y += L.v[i] * cy;
+        z += L.v[i] * cz;
+    }
+    const float scale = (kLambdaMax - kLambdaMin) / static_cast<float>(kHeroWavelengths);
+    ColorF rgb = XyzToLinearRgb(x * scale, y * scale, z * scale);
+    const ColorF& white = SpectralWhite();
+    return ColorF(rgb.r / white.r, rgb.g / white.g, rgb.b / white.b);
+}
+
+} // namespace raytracer
+
+#endif // RAYTRACER_SPECTRUM_HPP
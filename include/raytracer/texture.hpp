@@ -0,0 +1,137 @@
+#ifndef RAYTRACER_TEXTURE_HPP
+#define RAYTRACER_TEXTURE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include "raytracer/simd.hpp"
+#include "raytracer/vec3.hpp"
+#include "dr4/math/color.hpp"
+
+namespace raytracer {
+
+enum class TextureKind : uint8_t {
+    None,      // flat Object::color
+    Checker,   // 3D checkerboard of cubes `scale` wide
+    Grid,      // lines `lineWidth` cells wide on the lattice planes
+    Gradient,  // along `axis`, `scale` long and centred on the position
+    Noise,     // value-noise fBm with features about `scale` wide
+};
+
+inline const char* TextureKindName(TextureKind kind) {
+    switch (kind) {
+        case TextureKind::None: return "none";
+        case TextureKind::Checker: return "checker";
+        case TextureKind::Grid: return "grid";
+        case TextureKind::Gradient: return "gradient";
+        case TextureKind::Noise: return "noise";
+    }
+    return "none";
+}
+
+// Inverse of TextureKindName; false for unknown names.
+inline bool ParseTextureKind(const std::string& name, TextureKind& kind) {
+    for (TextureKind k : {TextureKind::None, TextureKind::Checker, TextureKind::Grid, TextureKind::Gradient,
+                          TextureKind::Noise}) {
+        if (name == TextureKindName(k)) {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Procedural surface pattern in the object's own frame (it moves, rotates
+// and scales with the object). Every pattern is a weight between
+// Object::color (0) and `color2` (1), so a texture is plain data: the
+// renderer evaluates Pattern for a whole packet of shading points at once,
+// one SIMD lane per point, instead of a call per ray.
+struct Texture {
+    TextureKind kind = TextureKind::None;
+    dr4::Color color2 = dr4::Color(255, 255, 255);
+    float scale = 1.0f;
+    float lineWidth = 0.05f;
+    Vec3 axis = Vec3(0, 1, 0);
+
+    // Weight of color2 at local points p with local normals n.
+    template <typename F>
+    F Pattern(const Vec3Lanes<F>& p, const Vec3Lanes<F>& n) const {
+        const F zero(0.0f), one(1.0f);
+        // just below the surface, so a face lying on a cell boundary (a
+        // ground plane through its own position) stays in one cell
+        const Vec3Lanes<F> q = (p - n * F(1e-4f * scale)) * F(1.0f / scale);
+        switch (kind) {
+            case TextureKind::None:
+                return zero;
+            case TextureKind::Checker: {
+                const F sum = Floor(q.x) + Floor(q.y) + Floor(q.z);
+                return sum - F(2.0f) * Floor(sum * F(0.5f));
+            }
+            case TextureKind::Grid: {
+                // a lattice plane parallel to the surface would cover all of it
+                const F half(0.5f * lineWidth), parallel(0.98f);
+                auto line = [&](F x, F nx) {
+                    const F f = x - Floor(x);
+                    return (Min(f, one - f) < half) & (nx * nx < parallel);
+                };
+                return Select(line(q.x, n.x) | line(q.y, n.y) | line(q.z, n.z), one, zero);
+            }
+            case TextureKind::Gradient: {
+                const Vec3 a = axis.Normalized() * (1.0f / scale);
+                const F t = p.x * F(a.x) + p.y * F(a.y) + p.z * F(a.z) + F(0.5f);
+                return Min(Max(t, zero), one);
+            }
+            case TextureKind::Noise: {
+                F sum = zero, amplitude(0.5f);
+                Vec3Lanes<F> x = q;
+                for (int octave = 0; octave < kNoiseOctaves; ++octave) {
+                    sum = sum + amplitude * ValueNoise(x);
+                    x = x * F(2.03f);
+                    amplitude = amplitude * F(0.5f);
+                }
+                return sum * F(1.0f / (1.0f - 1.0f / (1 << kNoiseOctaves)));
+            }
+        }
+        return zero;
+    }
+
+private:
+    static constexpr int kNoiseOctaves = 4;
+
+    template <typename F>
+    static F Fract(F x) {
+        return x - Floor(x);
+    }
+
+    // Hash of a lattice point to [0, 1) with float arithmetic only (no
+    // integer SIMD needed); exact enough for lattice coordinates below 1e4.
+    template <typename F>
+    static F Hash(F x, F y, F z) {
+        x = Fract(x * F(0.1031f));
+        y = Fract(y * F(0.1031f));
+        z = Fract(z * F(0.1031f));
+        const F d = x * (y + F(33.33f)) + y * (z + F(33.33f)) + z * (x + F(33.33f));
+        return Fract((x + y + d + d) * (z + d));
+    }
+
+    // Trilinear blend of the lattice hashes with a smoothstep fade.
+    template <typename F>
+    static F ValueNoise(const Vec3Lanes<F>& p) {
+        const F one(1.0f), ix = Floor(p.x), iy = Floor(p.y), iz = Floor(p.z);
+        const F fx = p.x - ix, fy = p.y - iy, fz = p.z - iz;
+        const F ux = fx * fx * (F(3.0f) - F(2.0f) * fx);
+        const F uy = fy * fy * (F(3.0f) - F(2.0f) * fy);
+        const F uz = fz * fz * (F(3.0f) - F(2.0f) * fz);
+        auto lerp = [](F a, F b, F t) { return a + (b - a) * t; };
+        const F jx = ix + one, jy = iy + one, jz = iz + one;
+        const F x00 = lerp(Hash(ix, iy, iz), Hash(jx, iy, iz), ux);
+        const F x10 = lerp(Hash(ix, jy, iz), Hash(jx, jy, iz), ux);
+        const F x01 = lerp(Hash(ix, iy, jz), Hash(jx, iy, jz), ux);
+        const F x11 = lerp(Hash(ix, jy, jz), Hash(jx, jy, jz), ux);
+        return lerp(lerp(x00, x10, uy), lerp(x01, x11, uy), uz);
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_TEXTURE_HPP
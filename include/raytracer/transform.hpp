@@ -0,0 +1,174 @@
+#ifndef RAYTRACER_TRANSFORM_HPP
+#define RAYTRACER_TRANSFORM_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include "raytracer/ray.hpp"
+#include "raytracer/vec3.hpp"
+
+namespace raytracer {
+
+// Row-major 3x3 matrix.
+template <typename S>
+struct Mat3T {
+    S m[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+
+    Mat3T() {}
+    template <typename U>
+    explicit Mat3T(const Mat3T<U>& o) {
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) m[i][j] = static_cast<S>(o.m[i][j]);
+        }
+    }
+
+    // Scale first, then rotation about x, y and z (degrees) in that order.
+    static Mat3T RotationScale(const Vec3& degrees, const Vec3& scale) {
+        const S k = S(3.14159265358979323846) / S(180);
+        const S cx = std::cos(S(degrees.x) * k), sx = std::sin(S(degrees.x) * k);
+        const S cy = std::cos(S(degrees.y) * k), sy = std::sin(S(degrees.y) * k);
+        const S cz = std::cos(S(degrees.z) * k), sz = std::sin(S(degrees.z) * k);
+        // Rz * Ry * Rx
+        const S r[3][3] = {
+            {cz * cy, cz * sy * sx - sz * cx, cz * sy * cx + sz * sx},
+            {sz * cy, sz * sy * sx + cz * cx, sz * sy * cx - cz * sx},
+            {-sy, cy * sx, cy * cx},
+        };
+        const S s[3] = {S(scale.x), S(scale.y), S(scale.z)};
+        Mat3T result;
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) result.m[i][j] = r[i][j] * s[j];
+        }
+        return result;
+    }
+
+    Mat3T Inverse() const {
+        Mat3T inv;
+        inv.m[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+        inv.m[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+        inv.m[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+        inv.m[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+        inv.m[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+        inv.m[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+        inv.m[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+        inv.m[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+        inv.m[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+        const S det = m[0][0] * inv.m[0][0] + m[0][1] * inv.m[1][0] + m[0][2] * inv.m[2][0];
+        const S invDet = det != S(0) ? S(1) / det : S(0);
+        for (auto& row : inv.m) {
+            for (S& v : row) v *= invDet;
+        }
+        return inv;
+    }
+
+    template <typename T>
+    Vec3T<T> Apply(const Vec3T<T>& v) const {
+        return Vec3T<T>(T(m[0][0]) * v.x + T(m[0][1]) * v.y + T(m[0][2]) * v.z,
+                        T(m[1][0]) * v.x + T(m[1][1]) * v.y + T(m[1][2]) * v.z,
+                        T(m[2][0]) * v.x + T(m[2][1]) * v.y + T(m[2][2]) * v.z);
+    }
+
+    template <typename T>
+    Vec3T<T> ApplyTransposed(const Vec3T<T>& v) const {
+        return Vec3T<T>(T(m[0][0]) * v.x + T(m[1][0]) * v.y + T(m[2][0]) * v.z,
+                        T(m[0][1]) * v.x + T(m[1][1]) * v.y + T(m[2][1]) * v.z,
+                        T(m[0][2]) * v.x + T(m[1][2]) * v.y + T(m[2][2]) * v.z);
+    }
+};
+
+using Mat3 = Mat3T<float>;
+using Mat3d = Mat3T<double>;
+
+// Rotation and scale about an object's position. The matrices are built in
+// double and cached in both precisions when the transform is set, so moving
+// a ray into object space costs two matrix-vector products and no
+// trigonometry, and the double engine keeps its accuracy.
+class Transform {
+public:
+    void Set(const Vec3& rotationDegrees, const Vec3& scale_) {
+        rotation = rotationDegrees;
+        scale = scale_;
+        identity = rotation.x == 0.0f && rotation.y == 0.0f && rotation.z == 0.0f && scale.x == 1.0f &&
+                   scale.y == 1.0f && scale.z == 1.0f;
+        const Mat3d forwardD = Mat3d::RotationScale(rotation, scale);
+        inverseD = forwardD.Inverse();
+        forward = Mat3(forwardD);
+        inverse = Mat3(inverseD);
+    }
+
+    const Vec3& Rotation() const { return rotation; }
+    const Vec3& Scale() const { return scale; }
+    bool IsIdentity() const { return identity; }
+
+    // Ray in object space with a unit direction. A distance t along it is
+    // t * worldPerLocal along the world ray.
+    template <typename T>
+    RayT<T> RayToLocal(const RayT<T>& ray, const Vec3& position, T& worldPerLocal) const {
+        const Mat3T<T>& inverse = Inverse<T>();
+        const Vec3T<T> origin = inverse.Apply(ray.origin - Vec3T<T>(position));
+        if (identity) {
+            worldPerLocal = T(1);
+            return RayT<T>::FromUnit(origin, ray.direction);
+        }
+        const Vec3T<T> direction = inverse.Apply(ray.direction);
+        const T length = direction.Length();
+        worldPerLocal = T(1) / length;
+        return RayT<T>::FromUnit(origin, direction * worldPerLocal);
+    }
+
+    Vec3 PointToLocal(const Vec3& point, const Vec3& position) const { return inverse.Apply(point - position); }
+
+    // Normals go through the inverse transpose.
+    template <typename T>
+    Vec3T<T> NormalToWorld(const Vec3T<T>& normal) const {
+        if (identity) return normal;
+        return Inverse<T>().ApplyTransposed(normal).Normalized();
+    }
+
+    // World normal in the object's frame, for surface patterns.
+    Vec3 NormalToLocal(const Vec3& normal) const {
+        if (identity) return normal;
+        return forward.ApplyTransposed(normal).Normalized();
+    }
+
+    // World box (relative to the position) around a transformed local box.
+    void BoundsToWorld(const Vec3& localMin, const Vec3& localMax, Vec3& min, Vec3& max) const {
+        if (identity) {
+            min = localMin;
+            max = localMax;
+            return;
+        }
+        const Vec3 center = forward.Apply((localMin + localMax) * 0.5f);
+        const Vec3 half = (localMax - localMin) * 0.5f;
+        Vec3 extent;
+        extent.x = std::fabs(forward.m[0][0]) * half.x + std::fabs(forward.m[0][1]) * half.y +
+                   std::fabs(forward.m[0][2]) * half.z;
+        extent.y = std::fabs(forward.m[1][0]) * half.x + std::fabs(forward.m[1][1]) * half.y +
+                   std::fabs(forward.m[1][2]) * half.z;
+        extent.z = std::fabs(forward.m[2][0]) * half.x + std::fabs(forward.m[2][1]) * half.y +
+                   std::fabs(forward.m[2][2]) * half.z;
+        min = center - extent;
+        max = center + extent;
+    }
+
+private:
+    Vec3 rotation;
+    Vec3 scale{1.0f, 1.0f, 1.0f};
+    bool identity = true;
+    Mat3 forward;
+    Mat3 inverse;
+    Mat3d inverseD;
+
+    template <typename T>
+    const Mat3T<T>& Inverse() const {
+        if constexpr (std::is_same_v<T, double>) {
+            return inverseD;
+        } else {
+            return inverse;
+        }
+    }
+};
+
+} // namespace raytracer
+
+#endif // RAYTRACER_TRANSFORM_HPP
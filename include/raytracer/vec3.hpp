@@ -5,50 +5,59 @@
 
 namespace raytracer {
 
-struct Vec3 {
-    float x, y, z;
-
-    Vec3() : x(0), y(0), z(0) {}
-    Vec3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
-
-    Vec3 operator+(const Vec3& other) const { return Vec3(x + other.x, y + other.y, z + other.z); }
-    Vec3 operator-(const Vec3& other) const { return Vec3(x - other.x, y - other.y, z - other.z); }
-    Vec3 operator*(float k) const { return Vec3(x * k, y * k, z * k); }
-    Vec3 operator/(float k) const { return Vec3(x / k, y / k, z / k); }
-    Vec3 operator-() const { return Vec3(-x, -y, -z); }
-
-    Vec3& operator+=(const Vec3& other) { x += other.x; y += other.y; z += other.z; return *this; }
-    Vec3& operator-=(const Vec3& other) { x -= other.x; y -= other.y; z -= other.z; return *this; }
-    Vec3& operator*=(float k) { x *= k; y *= k; z *= k; return *this; }
-    Vec3& operator/=(float k) { x /= k; y /= k; z /= k; return *this; }
-
-    float Dot(const Vec3& other) const { return x * other.x + y * other.y + z * other.z; }
-    Vec3 Cross(const Vec3& other) const {
-        return Vec3(
+// 3D vector over a scalar type: float for the viewport, double for analysis.
+template <typename T>
+struct Vec3T {
+    T x, y, z;
+
+    Vec3T() : x(0), y(0), z(0) {}
+    Vec3T(T x_, T y_, T z_) : x(x_), y(y_), z(z_) {}
+    template <typename U>
+    explicit Vec3T(const Vec3T<U>& o) : x(static_cast<T>(o.x)), y(static_cast<T>(o.y)), z(static_cast<T>(o.z)) {}
+
+    Vec3T operator+(const Vec3T& other) const { return Vec3T(x + other.x, y + other.y, z + other.z); }
+    Vec3T operator-(const Vec3T& other) const { return Vec3T(x - other.x, y - other.y, z - other.z); }
+    Vec3T operator*(T k) const { return Vec3T(x * k, y * k, z * k); }
+    Vec3T operator/(T k) const { return Vec3T(x / k, y / k, z / k); }
+    Vec3T operator-() const { return Vec3T(-x, -y, -z); }
+
+    Vec3T& operator+=(const Vec3T& other) { x += other.x; y += other.y; z += other.z; return *this; }
+    Vec3T& operator-=(const Vec3T& other) { x -= other.x; y -= other.y; z -= other.z; return *this; }
+    Vec3T& operator*=(T k) { x *= k; y *= k; z *= k; return *this; }
+    Vec3T& operator/=(T k) { x /= k; y /= k; z /= k; return *this; }
+
+    T Dot(const Vec3T& other) const { return x * other.x + y * other.y + z * other.z; }
+    Vec3T Cross(const Vec3T& other) const {
+        return Vec3T(
             y * other.z - z * other.y,
             z * other.x - x * other.z,
             x * other.y - y * other.x
         );
     }
 
-    float Length() const { return sqrt(x * x + y * y + z * z); }
-    float LengthSquared() const { return x * x + y * y + z * z; }
-    Vec3 Normalized() const {
-        float len = Length();
-        if (len < 1e-6f) return Vec3(0, 0, 0);
-        return *this / len;
+    T Length() const { return std::sqrt(x * x + y * y + z * z); }
+    T LengthSquared() const { return x * x + y * y + z * z; }
+    // One multiply by the reciprocal length; the zero test compiles to a select.
+    Vec3T Normalized() const {
+        T lenSq = LengthSquared();
+        T inv = lenSq > T(1e-12) ? T(1) / std::sqrt(lenSq) : T(0);
+        return *this * inv;
     }
     void Normalize() {
-        float len = Length();
-        if (len > 1e-6f) *this /= len;
+        T lenSq = LengthSquared();
+        T inv = lenSq > T(1e-12) ? T(1) / std::sqrt(lenSq) : T(1);
+        *this *= inv;
     }
 };
 
-inline Vec3 operator*(float k, const Vec3& v) {
+template <typename T>
+inline Vec3T<T> operator*(T k, const Vec3T<T>& v) {
     return v * k;
 }
 
+using Vec3 = Vec3T<float>;
+using Vec3d = Vec3T<double>;
+
 } // namespace raytracer
 
 #endif // RAYTRACER_VEC3_HPP
-
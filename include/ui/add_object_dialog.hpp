@@ -27,6 +27,11 @@ public:
     void SetOnOk(std::function<void(int kind)> cb) { onOk = std::move(cb); }
     void SetOnCancel(std::function<void()> cb) { onCancel = std::move(cb); }
 
+    // .stl and .obj files of this directory are listed as meshes (kind 7).
+    void SetModelsDirectory(std::string dir) { modelsDir = std::move(dir); }
+    // Model file of the selected item, empty for built-in objects.
+    std::string GetSelectedPath() const;
+
 protected:
     hui::EventResult PropagateToChildren(hui::Event& event) override;
     void Redraw() const override;
@@ -37,7 +42,7 @@ protected:
     hui::EventResult OnKeyDown(hui::KeyEvent& evt) override;
 
 private:
-    struct Item { std::string label; int kind; };
+    struct Item { std::string label; int kind; std::string path = {}; };
 
     bool visible = false;
     float titleBarHeight = 26.0f;
@@ -45,6 +50,7 @@ private:
     dr4::Vec2f dragOffset;
 
     std::vector<Item> items;
+    std::string modelsDir;
     int selectedIndex = 0;
 
     float scrollOffset = 0.0f;
@@ -61,6 +67,7 @@ private:
     std::function<void()> onCancel;
 
     void ClampScroll();
+    void RefreshModels();
 };
 
 } // namespace ui
@@ -34,6 +34,7 @@ public:
     void SetupConnections(raytracer::Scene* scene);
     void SetPluginManager(cum::Manager* manager);
     void SetPluginsDirectory(std::string dir);
+    void SetModelsDirectory(std::string dir);
     
     PropertiesWindow* GetPropertiesWindow();
 
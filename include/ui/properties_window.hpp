@@ -15,6 +15,7 @@ namespace hui {
 
 namespace raytracer {
     class Scene;  
+    class InstanceGeometry;
 }
 
 namespace ui {
@@ -32,8 +33,10 @@ public:
     
     void CopyObject();
     void PasteObject(raytracer::Scene* scene);
+    // Pastes an Instance that shares the copied object's geometry.
+    void PasteInstance(raytracer::Scene* scene);
     bool HasCopiedObject() const { return copiedObject != nullptr; }
-    void SetOnPasteRequest(std::function<void()> callback) { onPasteRequest = callback; }
+    void SetOnPasteRequest(std::function<void(bool asInstance)> callback) { onPasteRequest = callback; }
     void SetOnObjectChanged(std::function<void()> callback) { onObjectChanged = std::move(callback); }
     void SetOnObjectCommitted(std::function<void(raytracer::Object*)> callback) { onObjectCommitted = std::move(callback); }
 
@@ -50,7 +53,7 @@ protected:
 
 private:
     enum class ButtonId : uint8_t { None = 0, Copy, Paste, Enter };
-    enum class ObjKind : uint8_t { Unknown = 0, Sphere, Plane, RectPlane, Disk, Prism, Pyramid, Light };
+    enum class ObjKind : uint8_t { Unknown = 0, Sphere, Plane, RectPlane, Disk, Prism, Pyramid, Light, Quadric, Lens, Sdf };
 
     raytracer::Object* currentObject = nullptr;
     ObjKind currentKind = ObjKind::Unknown;
@@ -74,6 +77,15 @@ private:
     std::string diskRadiusText, diskNxText, diskNyText, diskNzText;
     std::string prismSizeXText, prismSizeYText, prismSizeZText;
     std::string pyramidBaseText, pyramidHeightText;
+    std::string quadricRadiusText, quadricHeightText, quadricCapsText, quadricWaistText;
+    std::string lensFrontRText, lensFrontKText, lensFrontA4Text, lensFrontA6Text;
+    std::string lensBackRText, lensBackKText, lensBackA4Text, lensBackA6Text;
+    std::string lensThicknessText, lensApertureText, lensGlassText;
+    std::string sdfBlendText, sdfMaxStepsText;
+    std::string rotXText, rotYText, rotZText;
+    std::string scaleXText, scaleYText, scaleZText;
+    std::string textureText, textureScaleText, color2RText, color2GText, color2BText;
+    std::string mediumText, mediumDensityText, mediumAnisotropyText;
 
     std::unique_ptr<raytracer::Object> draftObject;
     raytracer::Scene* draftScene = nullptr;
@@ -92,16 +104,20 @@ private:
     ButtonId hoveredButton = ButtonId::None;
     ButtonId pressedButton = ButtonId::None;
     raytracer::Object* copiedObject = nullptr;
-    std::function<void()> onPasteRequest;
+    // copiedObject in its own frame, made on the first instance paste
+    std::shared_ptr<const raytracer::InstanceGeometry> copiedGeometry;
+    std::function<void(bool asInstance)> onPasteRequest;
     std::function<void()> onObjectChanged;
     std::function<void(raytracer::Object*)> onObjectCommitted;
     
     void ParseAndApplyChanges();
-    raytracer::Object* CloneObject(raytracer::Object* obj) const;
+    raytracer::Object* CloneObject(const raytracer::Object* obj) const;
+    raytracer::Object* CloneShape(const raytracer::Object* obj) const;
     std::string* GetFieldByIndex(int idx);
     void ApplyTextInput(const char* text);
     bool IsNumericField(int idx) const;
     int FieldCount() const;
+    int ShapeFieldCount() const;
     float FieldValueOffset(int idx) const;
 };
 
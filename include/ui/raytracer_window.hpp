@@ -6,7 +6,10 @@
 #include "raytracer/scene.hpp"
 #include "raytracer/camera.hpp"
 #include "raytracer/object.hpp"
+#include <cstdint>
 #include <functional>
+#include <string>
+#include <vector>
 
 namespace hui {
     class MouseButtonEvent;
@@ -21,12 +24,14 @@ public:
     RayTracerWindow(hui::UI* ui, raytracer::Scene* scene, raytracer::Camera* camera);
     
     void SetRayTracer(raytracer::RayTracer* rt) { raytracer = rt; needsRender = true; renderDelayFrames = 0; }
-    void SetSelectedObject(raytracer::Object* obj) { selectedObject = obj; ForceRedraw(); }
+    void SetSelectedObject(raytracer::Object* obj);
     void SetSelectedObject(const raytracer::Object* obj); 
     raytracer::Object* GetSelectedObject() const { return selectedObject; }
     void MarkDirty();
-    void SetOnPasteRequest(std::function<void()> callback) { onPasteRequest = callback; }
+    void SetOnPasteRequest(std::function<void(bool asInstance)> callback) { onPasteRequest = callback; }
     void SetOnObjectSelected(std::function<void(raytracer::Object*)> callback) { onObjectSelected = std::move(callback); }
+    // Heap allocations made by the last Redraw, including the render.
+    uint64_t GetLastRedrawAllocations() const { return lastRedrawAllocations; }
 
 protected:
     void Redraw() const override;
@@ -41,6 +46,12 @@ private:
     raytracer::Camera* camera;
     raytracer::RayTracer* raytracer;
     raytracer::Object* selectedObject = nullptr;
+    std::vector<raytracer::Object*> selectedObjects;
+    raytracer::Object* hoveredObject = nullptr;
+    bool boxPending = false;
+    bool boxSelecting = false;
+    dr4::Vec2f boxStart;
+    dr4::Vec2f boxEnd;
     bool isCollapsed = false;
     float titleBarHeight = 26.0f;
     bool dragging = false;
@@ -51,10 +62,23 @@ private:
     mutable dr4::Image* renderImage = nullptr; 
     mutable bool needsRender = true; 
     mutable int renderDelayFrames = 0;
-    std::function<void()> onPasteRequest;
+    // draw primitives are created once and updated every Redraw
+    mutable dr4::Rectangle* headerBar = nullptr;
+    mutable dr4::Text* titleText = nullptr;
+    mutable dr4::Text* arrowText = nullptr;
+    mutable dr4::Rectangle* bandRect = nullptr;
+    mutable dr4::Rectangle* selectionRect = nullptr;
+    mutable std::string titleBuffer;
+    mutable std::string shownTitle;
+    mutable bool shownCollapsed = false;
+    mutable uint64_t lastRedrawAllocations = 0;
+    std::function<void(bool asInstance)> onPasteRequest;
     std::function<void(raytracer::Object*)> onObjectSelected;
     
-    void DrawSelectionBox(dr4::Texture& texture, raytracer::Object* obj) const;
+    void RedrawContents() const;
+    void DrawSelectionBox(dr4::Texture& texture, raytracer::Object* obj,
+                          dr4::Color color = dr4::Color(255, 255, 0), float thickness = 2.0f) const;
+    void SelectObjects(std::vector<raytracer::Object*> objs);
     dr4::Vec2f ProjectToScreen(const raytracer::Vec3& point, bool& visible) const;
 };
 
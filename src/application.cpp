@@ -4,6 +4,7 @@
 #include "hui/event.hpp"
 #include "raytracer/objects.hpp"
 #include <iostream>
+#include <cstdlib>
 #include <memory>
 #include <filesystem>
 #include <vector>
@@ -45,6 +46,24 @@ std::string GetPluginsDirectory() {
     return projectPlugins.string();
 }
 
+// MYZEMAX_MODELS_DIR overrides the models/ directory next to plugins/.
+std::string GetModelsDirectory() {
+    if (const char* env = std::getenv("MYZEMAX_MODELS_DIR")) {
+        if (*env) return env;
+    }
+    std::string exePath = GetExecutablePath();
+    if (exePath.empty()) {
+        return "models";
+    }
+
+    std::filesystem::path exeDir = std::filesystem::path(exePath).parent_path();
+    std::filesystem::path projectModels = exeDir.parent_path() / "models";
+    if (std::filesystem::exists(projectModels)) {
+        return projectModels.string();
+    }
+    return (exeDir / "models").string();
+}
+
 std::string GetFontsDirectory() {
     std::string exePath = GetExecutablePath();
     if (exePath.empty()) {
@@ -134,12 +153,19 @@ Application::Application() {
         55.0f
     );
     raytracer = new raytracer::RayTracer(&scene, &camera);
+    // scene haze, off until toggled with Ctrl+H
+    scene.medium.density = 0.02f;
+    scene.medium.anisotropy = 0.5f;
+    scene.medium.extent = 40.0f;
+    std::cout << "Renderer: " << raytracer->DescribeThreads() << std::endl;
 
     
     auto ground = std::make_unique<raytracer::Plane>(raytracer::Vec3(0, 1, 0), "Ground");
     ground->position = raytracer::Vec3(0.0f, -2.0f, 0.0f);
     ground->color = dr4::Color(60, 70, 90);
     ground->reflectivity = 0.15f;
+    ground->texture.kind = raytracer::TextureKind::Checker;
+    ground->texture.color2 = dr4::Color(90, 100, 120);
     scene.AddObject(std::move(ground));
 
     
@@ -153,6 +179,8 @@ Application::Application() {
     sphereGlass->position = raytracer::Vec3(1.0f, -1.1f, -1.8f);
     sphereGlass->color = dr4::Color(180, 220, 255);
     sphereGlass->refractiveIndex = 1.45f;
+    sphereGlass->dispersion.model = raytracer::DispersionModel::Cauchy;
+    sphereGlass->dispersion.b[0] = 0.00354f;
     sphereGlass->reflectivity = 0.10f;
     scene.AddObject(std::move(sphereGlass));
 
@@ -197,6 +225,7 @@ Application::Application() {
     mainWindow->SetSize(window->GetSize());
     mainWindow->SetupLayout(&scene, &camera, raytracer);
     mainWindow->SetPluginsDirectory(pluginsDir);
+    mainWindow->SetModelsDirectory(GetModelsDirectory());
     mainWindow->SetPluginManager(pluginManager);
     ui->SetRoot(mainWindow);
 }
@@ -0,0 +1,504 @@
+#include "raytracer/mesh.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MYZEMAX_HAVE_MMAP 1
+#endif
+
+namespace raytracer {
+
+namespace {
+
+// Read-only view of a whole file: a memory mapping where available,
+// otherwise one read into a buffer.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#if defined(MYZEMAX_HAVE_MMAP)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat " + path);
+        }
+        size = static_cast<size_t>(st.st_size);
+        if (size > 0) {
+            void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Cannot map " + path);
+            }
+            ::madvise(p, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(p);
+        }
+        ::close(fd);
+#else
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) throw std::runtime_error("Cannot open " + path);
+        std::fseek(f, 0, SEEK_END);
+        buffer.resize(static_cast<size_t>(std::ftell(f)));
+        std::fseek(f, 0, SEEK_SET);
+        size = std::fread(buffer.data(), 1, buffer.size(), f);
+        std::fclose(f);
+        data = buffer.data();
+#endif
+    }
+
+    ~MappedFile() {
+#if defined(MYZEMAX_HAVE_MMAP)
+        if (data) ::munmap(const_cast<char*>(data), size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data = nullptr;
+    size_t size = 0;
+
+private:
+#if !defined(MYZEMAX_HAVE_MMAP)
+    std::vector<char> buffer;
+#endif
+};
+
+// Merges STL corners with bit-identical coordinates into shared vertices
+// (open addressing, -0 folded into +0). The table doubles whenever it gets
+// half full, so meshes with few shared corners (triangle soup) still load.
+// Coordinates must be finite: NaN never compares equal to itself.
+class VertexWelder {
+public:
+    VertexWelder(std::vector<float>& positions_, size_t expected) : positions(positions_) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity <<= 1;
+        slots.assign(capacity, kEmpty);
+        mask = capacity - 1;
+        positions.reserve(expected * 3);
+    }
+
+    uint32_t Add(float x, float y, float z) {
+        x += 0.0f;
+        y += 0.0f;
+        z += 0.0f;
+        for (size_t i = Hash(x, y, z) & mask;; i = (i + 1) & mask) {
+            const uint32_t v = slots[i];
+            if (v == kEmpty) {
+                const uint32_t index = static_cast<uint32_t>(positions.size() / 3);
+                positions.push_back(x);
+                positions.push_back(y);
+                positions.push_back(z);
+                if ((static_cast<size_t>(index) + 1) * 2 > slots.size()) {
+                    Grow();
+                } else {
+                    slots[i] = index;
+                }
+                return index;
+            }
+            const float* p = &positions[static_cast<size_t>(v) * 3];
+            if (p[0] == x && p[1] == y && p[2] == z) return v;
+        }
+    }
+
+private:
+    static constexpr uint32_t kEmpty = 0xffffffffu;
+    std::vector<float>& positions;
+    std::vector<uint32_t> slots;
+    size_t mask = 0;
+
+    static size_t Hash(float x, float y, float z) {
+        uint32_t bits[3];
+        std::memcpy(&bits[0], &x, 4);
+        std::memcpy(&bits[1], &y, 4);
+        std::memcpy(&bits[2], &z, 4);
+        size_t h = (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        return h ^ (h >> 15);
+    }
+
+    // Doubles the table and reinserts every vertex, the newest included.
+    void Grow() {
+        slots.assign(slots.size() * 2, kEmpty);
+        mask = slots.size() - 1;
+        const size_t count = positions.size() / 3;
+        for (size_t v = 0; v < count; ++v) {
+            const float* p = &positions[v * 3];
+            size_t i = Hash(p[0], p[1], p[2]) & mask;
+            while (slots[i] != kEmpty) i = (i + 1) & mask;
+            slots[i] = static_cast<uint32_t>(v);
+        }
+    }
+};
+
+void LoadBinaryStl(const MappedFile& file, const std::string& path, MeshData& mesh) {
+    if (file.size < 84) throw std::runtime_error(path + ": too short for binary STL");
+    uint32_t count;
+    std::memcpy(&count, file.data + 80, 4);
+    if (84 + static_cast<uint64_t>(count) * 50 != file.size) {
+        throw std::runtime_error(path + ": not a binary STL (ASCII STL is not supported)");
+    }
+
+    mesh.indices.resize(static_cast<size_t>(count) * 3);
+    VertexWelder welder(mesh.positions, static_cast<size_t>(count) / 2 + 3);
+    const char* rec = file.data + 84;
+    for (uint32_t t = 0; t < count; ++t, rec += 50) {
+        float v[9];
+        std::memcpy(v, rec + 12, sizeof(v));  // skip the stored normal
+        for (float coord : v) {
+            if (!std::isfinite(coord)) {
+                throw std::runtime_error(path + ": non-finite vertex coordinate in triangle " + std::to_string(t));
+            }
+        }
+        for (int c = 0; c < 3; ++c) {
+            mesh.indices[static_cast<size_t>(t) * 3 + static_cast<size_t>(c)] =
+                welder.Add(v[c * 3], v[c * 3 + 1], v[c * 3 + 2]);
+        }
+    }
+}
+
+// Minimal locale-independent number parsing over the mapped text.
+inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char* SkipSpaces(const char* p, const char* end) {
+    while (p < end && IsSpace(*p)) ++p;
+    return p;
+}
+
+const char* ParseFloat(const char* p, const char* end, float& out) {
+    p = SkipSpaces(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            ++digits;
+        } else {
+            ++exponent;
+        }
+        ++p;
+    }
+    if (p < end && *p == '.') {
+        ++p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                ++digits;
+                --exponent;
+            }
+            ++p;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool expNegative = false;
+        if (p < end && (*p == '-' || *p == '+')) expNegative = *p++ == '-';
+        int e = 0;
+        while (p < end && *p >= '0' && *p <= '9') e = std::min(e * 10 + (*p++ - '0'), 10000);
+        exponent += expNegative ? -e : e;
+    }
+    double value = static_cast<double>(mantissa);
+    if (exponent != 0) value *= std::pow(10.0, exponent);
+    out = static_cast<float>(negative ? -value : value);
+    return p;
+}
+
+const char* ParseInt(const char* p, const char* end, long& out, bool& ok) {
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        ++p;
+    }
+    ok = p < end && *p >= '0' && *p <= '9';
+    long v = 0;
+    while (p < end && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+    out = negative ? -v : v;
+    return p;
+}
+
+void LoadObj(const MappedFile& file, const std::string& path, MeshData& mesh) {
+    const char* p = file.data;
+    const char* end = file.data + file.size;
+    std::vector<uint32_t> face;
+    size_t lineNumber = 0;
+
+    while (p < end) {
+        ++lineNumber;
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!lineEnd) lineEnd = end;
+        p = SkipSpaces(p, lineEnd);
+
+        if (lineEnd - p > 2 && p[0] == 'v' && IsSpace(p[1])) {
+            float xyz[3];
+            const char* q = p + 1;
+            for (float& c : xyz) {
+                q = ParseFloat(q, lineEnd, c);
+                if (!std::isfinite(c)) {
+                    throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": non-finite vertex coordinate");
+                }
+            }
+            mesh.positions.insert(mesh.positions.end(), xyz, xyz + 3);
+        } else if (lineEnd - p > 2 && p[0] == 'f' && IsSpace(p[1])) {
+            face.clear();
+            const char* q = p + 1;
+            const long vertexCount = static_cast<long>(mesh.positions.size() / 3);
+            while (true) {
+                q = SkipSpaces(q, lineEnd);
+                if (q >= lineEnd) break;
+                long index;
+                bool ok;
+                q = ParseInt(q, lineEnd, index, ok);
+                // texture and normal references after '/' are not used
+                while (q < lineEnd && !IsSpace(*q)) ++q;
+                if (!ok) break;
+                index = index < 0 ? vertexCount + index : index - 1;
+                if (index < 0 || index >= vertexCount) {
+                    throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": vertex index out of range");
+                }
+                face.push_back(static_cast<uint32_t>(index));
+            }
+            // polygons are split into a fan
+            for (size_t i = 2; i < face.size(); ++i) {
+                mesh.indices.push_back(face[0]);
+                mesh.indices.push_back(face[i - 1]);
+                mesh.indices.push_back(face[i]);
+            }
+        }
+        p = lineEnd + 1;
+    }
+}
+
+// Axis-aligned box in the first three lanes; the fourth lane is unused.
+struct Bounds {
+    Float4 lo = Float4(std::numeric_limits<float>::max());
+    Float4 hi = Float4(-std::numeric_limits<float>::max());
+
+    void Grow(Float4 p) {
+        lo = Min(lo, p);
+        hi = Max(hi, p);
+    }
+    void Grow(const Bounds& b) {
+        lo = Min(lo, b.lo);
+        hi = Max(hi, b.hi);
+    }
+    float HalfArea() const {
+        alignas(16) float d[4];
+        (Max(hi - lo, Float4(0.0f))).Store(d);
+        return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+    }
+};
+
+// Triangle bounds are moved during the build instead of an index array, so
+// binning and partitioning stream through memory.
+struct BuildPrim {
+    Bounds box;
+    uint32_t triangle;
+
+    Float4 Centroid() const { return (box.lo + box.hi) * Float4(0.5f); }
+};
+
+void SetNodeBounds(BvhNode& node, const Bounds& box) {
+    alignas(16) float lo[4], hi[4];
+    box.lo.Store(lo);
+    box.hi.Store(hi);
+    std::memcpy(node.bmin, lo, sizeof(node.bmin));
+    std::memcpy(node.bmax, hi, sizeof(node.bmax));
+}
+
+} // namespace
+
+void MeshData::BuildBvh() {
+    nodes.clear();
+    const uint32_t triCount = static_cast<uint32_t>(TriangleCount());
+    if (triCount == 0) return;
+
+    constexpr int kBins = 12;
+    constexpr uint32_t kLeafSize = 4;
+    constexpr int kMaxDepth = 60;  // traversal stack is 64 entries
+
+    std::vector<BuildPrim> prims(triCount);
+    Bounds rootBox, rootCentroids;
+    for (uint32_t t = 0; t < triCount; ++t) {
+        BuildPrim& prim = prims[t];
+        for (int c = 0; c < 3; ++c) {
+            const float* p = &positions[static_cast<size_t>(indices[t * 3 + static_cast<uint32_t>(c)]) * 3];
+            prim.box.Grow(Float4(p[0], p[1], p[2], 0.0f));
+        }
+        prim.triangle = t;
+        rootBox.Grow(prim.box);
+        rootCentroids.Grow(prim.Centroid());
+    }
+
+    // children's bounds come out of the parent's bins, so every level reads
+    // its triangles once for binning and once for partitioning
+    struct Task {
+        Bounds centroids;
+        uint32_t node, first, count;
+        int depth;
+    };
+    std::vector<Task> tasks;
+    nodes.reserve(static_cast<size_t>(triCount) / 2 + 1);
+    nodes.push_back(BvhNode());
+    SetNodeBounds(nodes[0], rootBox);
+    tasks.push_back({rootCentroids, 0, 0, triCount, 0});
+
+    while (!tasks.empty()) {
+        const Task task = tasks.back();
+        tasks.pop_back();
+        nodes[task.node].leftOrFirst = task.first;
+        nodes[task.node].count = task.count;
+        if (task.count <= kLeafSize || task.depth >= kMaxDepth) continue;
+
+        alignas(16) float cmin[4], cmax[4];
+        task.centroids.lo.Store(cmin);
+        task.centroids.hi.Store(cmax);
+        int axis = 0;
+        for (int a = 1; a < 3; ++a) {
+            if (cmax[a] - cmin[a] > cmax[axis] - cmin[axis]) axis = a;
+        }
+        const float extent = cmax[axis] - cmin[axis];
+        if (extent <= 0.0f) continue;  // coincident centroids, nothing to split
+
+        const Float4 origin = task.centroids.lo;
+        const Float4 scale(kBins / extent);
+        auto binOf = [&](const BuildPrim& prim) {
+            alignas(16) int32_t b[4];
+            ToInt((prim.Centroid() - origin) * scale, b);
+            return std::min(kBins - 1, std::max(0, static_cast<int>(b[axis])));
+        };
+
+        Bounds binBox[kBins], binCentroids[kBins];
+        uint32_t binCount[kBins] = {};
+        const auto begin = prims.begin() + task.first;
+        const auto end = begin + task.count;
+        for (auto it = begin; it != end; ++it) {
+            const int b = binOf(*it);
+            ++binCount[b];
+            binBox[b].Grow(it->box);
+            binCentroids[b].Grow(it->Centroid());
+        }
+
+        // split b puts bins [0, b) left and [b, kBins) right; only the costs
+        // are swept, the winning split's bounds are merged afterwards
+        float leftCost[kBins] = {};
+        Bounds sweep;
+        uint32_t sweepCount = 0;
+        for (int b = 1; b < kBins; ++b) {
+            sweep.Grow(binBox[b - 1]);
+            sweepCount += binCount[b - 1];
+            leftCost[b] = sweep.HalfArea() * static_cast<float>(sweepCount);
+        }
+        float bestCost = std::numeric_limits<float>::max();
+        int best = -1;
+        sweep = Bounds();
+        sweepCount = 0;
+        for (int b = kBins - 1; b > 0; --b) {
+            sweep.Grow(binBox[b]);
+            sweepCount += binCount[b];
+            if (sweepCount == 0 || sweepCount == task.count) continue;
+            const float cost = leftCost[b] + sweep.HalfArea() * static_cast<float>(sweepCount);
+            if (cost < bestCost) {
+                bestCost = cost;
+                best = b;
+            }
+        }
+        if (best < 0) continue;
+        Bounds leftBox, leftCentroids, rightBox, rightCentroids;
+        for (int b = 0; b < kBins; ++b) {
+            (b < best ? leftBox : rightBox).Grow(binBox[b]);
+            (b < best ? leftCentroids : rightCentroids).Grow(binCentroids[b]);
+        }
+        // small nodes stay leaves when splitting does not beat testing every triangle
+        if (task.count <= 16) {
+            Bounds box = leftBox;
+            box.Grow(rightBox);
+            if (bestCost >= box.HalfArea() * static_cast<float>(task.count)) continue;
+        }
+
+        const uint32_t mid = static_cast<uint32_t>(
+            std::partition(begin, end, [&](const BuildPrim& prim) { return binOf(prim) < best; }) - prims.begin());
+
+        const uint32_t left = static_cast<uint32_t>(nodes.size());
+        nodes[task.node].leftOrFirst = left;
+        nodes[task.node].count = 0;
+        nodes.push_back(BvhNode());
+        nodes.push_back(BvhNode());
+        SetNodeBounds(nodes[left], leftBox);
+        SetNodeBounds(nodes[left + 1], rightBox);
+        tasks.push_back({leftCentroids, left, task.first, mid - task.first, task.depth + 1});
+        tasks.push_back({rightCentroids, left + 1, mid, task.first + task.count - mid, task.depth + 1});
+    }
+
+    // store triangles in leaf order
+    std::vector<uint32_t> sorted(indices.size());
+    for (uint32_t i = 0; i < triCount; ++i) {
+        std::memcpy(&sorted[static_cast<size_t>(i) * 3], &indices[static_cast<size_t>(prims[i].triangle) * 3],
+                    3 * sizeof(uint32_t));
+    }
+    indices.swap(sorted);
+    nodes.shrink_to_fit();
+
+    boundsMin = Vec3(nodes[0].bmin[0], nodes[0].bmin[1], nodes[0].bmin[2]);
+    boundsMax = Vec3(nodes[0].bmax[0], nodes[0].bmax[1], nodes[0].bmax[2]);
+}
+
+int MeshData::CountCrossings(const Ray& ray) const {
+    if (nodes.empty()) return 0;
+    const WatertightRay<float> wr(ray);
+    const float inv[3] = {1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z};
+    const float far = std::numeric_limits<float>::max();
+    int crossings = 0;
+    uint32_t stack[64];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const BvhNode& node = nodes[stack[--sp]];
+        float tEnter;
+        if (!BvhSlabTest(node, wr.org, inv, far, tEnter)) continue;
+        if (node.count > 0) {
+            for (uint32_t i = 0; i < node.count; ++i) {
+                float t = far;
+                if (IntersectTriangle(wr, node.leftOrFirst + i, t)) ++crossings;
+            }
+        } else if (sp < 63) {
+            stack[sp++] = node.leftOrFirst;
+            stack[sp++] = node.leftOrFirst + 1;
+        }
+    }
+    return crossings;
+}
+
+std::shared_ptr<MeshData> LoadMesh(const std::string& path) {
+    const MappedFile file(path);
+    auto mesh = std::make_shared<MeshData>();
+
+    std::string ext;
+    const size_t dot = path.find_last_of('.');
+    if (dot != std::string::npos) {
+        for (size_t i = dot + 1; i < path.size(); ++i) ext += static_cast<char>(std::tolower(static_cast<unsigned char>(path[i])));
+    }
+    if (ext == "stl") {
+        LoadBinaryStl(file, path, *mesh);
+    } else if (ext == "obj") {
+        LoadObj(file, path, *mesh);
+    } else {
+        throw std::runtime_error(path + ": unsupported mesh format (expected .stl or .obj)");
+    }
+    if (mesh->indices.empty()) throw std::runtime_error(path + ": no triangles");
+
+    mesh->positions.shrink_to_fit();
+    mesh->indices.shrink_to_fit();
+    mesh->BuildBvh();
+    return mesh;
+}
+
+} // namespace raytracer
@@ -4,6 +4,8 @@
 #include "hui/event.hpp"
 #include "hui/ui.hpp"
 #include <algorithm>
+#include <cctype>
+#include <filesystem>
 
 namespace ui {
 
@@ -16,11 +18,48 @@ AddObjectDialog::AddObjectDialog(hui::UI* ui) : Container(ui) {
         {"Disk", 2},
         {"Prism", 3},
         {"Pyramid", 4},
+        {"Cylinder", 8},
+        {"Cone", 9},
+        {"Paraboloid", 10},
+        {"Hyperboloid", 11},
+        {"Ellipsoid", 12},
+        {"Lens", 14},
+        {"Lens (CSG)", 13},
+        {"Blend (SDF)", 15},
+        {"Haze volume", 16},
         {"Light", 5},
     };
 }
 
+void AddObjectDialog::RefreshModels() {
+    items.erase(std::remove_if(items.begin(), items.end(), [](const Item& item) { return item.kind == 7; }),
+                items.end());
+    if (modelsDir.empty()) return;
+
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (!fs::is_directory(modelsDir, ec)) return;
+    std::vector<fs::path> models;
+    for (const auto& entry : fs::directory_iterator(modelsDir, ec)) {
+        if (!entry.is_regular_file()) continue;
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (ext == ".stl" || ext == ".obj") models.push_back(entry.path());
+    }
+    std::sort(models.begin(), models.end());
+    for (const auto& model : models) {
+        items.push_back({"Mesh: " + model.filename().string(), 7, model.string()});
+    }
+}
+
+std::string AddObjectDialog::GetSelectedPath() const {
+    if (selectedIndex < 0 || selectedIndex >= static_cast<int>(items.size())) return "";
+    return items[selectedIndex].path;
+}
+
 void AddObjectDialog::Show() {
+    RefreshModels();
+    selectedIndex = std::clamp(selectedIndex, 0, std::max(0, static_cast<int>(items.size()) - 1));
     visible = true;
     dragging = false;
     draggingThumb = false;
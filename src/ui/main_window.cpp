@@ -9,6 +9,11 @@
 #include "ui/draw_overlay.hpp"
 #include "raytracer/raytracer.hpp"
 #include "raytracer/objects.hpp"
+#include "raytracer/mesh.hpp"
+#include "raytracer/quadric.hpp"
+#include "raytracer/csg.hpp"
+#include "raytracer/lens.hpp"
+#include "raytracer/sdf.hpp"
 #include "hui/ui.hpp"
 #include "dr4/keycodes.hpp"
 #include <iostream>
@@ -50,6 +55,12 @@ void MainWindow::SetPluginsDirectory(std::string dir) {
     }
 }
 
+void MainWindow::SetModelsDirectory(std::string dir) {
+    if (addObjectDialog) {
+        addObjectDialog->SetModelsDirectory(std::move(dir));
+    }
+}
+
 hui::EventResult MainWindow::PropagateToChildren(hui::Event& event) {
 
     if (auto* k = dynamic_cast<hui::KeyEvent*>(&event)) {
@@ -268,9 +279,13 @@ void MainWindow::SetupConnections(raytracer::Scene* scene) {
         }
     });
     
-    auto pasteHandler = [this, scene]() {
+    auto pasteHandler = [this, scene](bool asInstance) {
         if (propertiesWindow && propertiesWindow->HasCopiedObject()) {
-            propertiesWindow->PasteObject(scene);
+            if (asInstance) {
+                propertiesWindow->PasteInstance(scene);
+            } else {
+                propertiesWindow->PasteObject(scene);
+            }
             objectsPanel->RefreshList();
             raytracerWindow->MarkDirty();
         }
@@ -379,6 +394,88 @@ void MainWindow::SetupConnections(raytracer::Scene* scene) {
                     created = std::move(obj);
                     break;
                 }
+                case 8:
+                case 9:
+                case 10:
+                case 11:
+                case 12: {
+                    const auto quadricKind = static_cast<raytracer::QuadricKind>(kind - 8);
+                    created = std::make_unique<raytracer::Quadric>(quadricKind, 1.0f, 2.0f,
+                                                                   makeUnique(raytracer::QuadricKindName(quadricKind)));
+                    break;
+                }
+                case 13: {
+                    // biconvex lens: two R = 2 spheres 1.5 apart on each side
+                    auto front = std::make_unique<raytracer::Sphere>(2.0f, "Front surface");
+                    front->position = raytracer::Vec3(0, 0, -1.5f);
+                    auto back = std::make_unique<raytracer::Sphere>(2.0f, "Back surface");
+                    back->position = raytracer::Vec3(0, 0, 1.5f);
+                    auto obj = std::make_unique<raytracer::Csg>(raytracer::CsgOp::Intersection, std::move(front),
+                                                                std::move(back), makeUnique("Lens"));
+                    obj->color = dr4::Color(200, 230, 255);
+                    obj->refractiveIndex = 1.5f;
+                    obj->reflectivity = 0.05f;
+                    created = std::move(obj);
+                    break;
+                }
+                case 14: {
+                    auto obj = std::make_unique<raytracer::Lens>(raytracer::LensSurface{3.0f}, raytracer::LensSurface{-3.0f},
+                                                                 0.5f, 2.0f, makeUnique("Lens"));
+                    obj->color = dr4::Color(200, 230, 255);
+                    obj->reflectivity = 0.05f;
+                    created = std::move(obj);
+                    break;
+                }
+                case 15: {
+                    // rounded housing with a dome blended on top and a filleted hole through both
+                    raytracer::SdfTerm housing;
+                    housing.primitive.shape = raytracer::SdfShape::Box;
+                    housing.primitive.size = raytracer::Vec3(0.8f, 0.4f, 0.6f);
+                    housing.primitive.rounding = 0.1f;
+                    raytracer::SdfTerm dome;
+                    dome.primitive.center = raytracer::Vec3(0, 0.45f, 0);
+                    dome.primitive.size = raytracer::Vec3(0.45f, 0.45f, 0.45f);
+                    dome.blend = 0.25f;
+                    raytracer::SdfTerm hole;
+                    hole.primitive.shape = raytracer::SdfShape::Cylinder;
+                    hole.primitive.size = raytracer::Vec3(0.2f, 1.5f, 0.2f);
+                    hole.op = raytracer::SdfOp::Subtract;
+                    hole.blend = 0.1f;
+                    auto obj = std::make_unique<raytracer::Sdf>(std::vector<raytracer::SdfTerm>{housing, dome, hole},
+                                                                makeUnique("Blend"));
+                    obj->color = dr4::Color(220, 200, 160);
+                    created = std::move(obj);
+                    break;
+                }
+                case 16: {
+                    // box of forward-scattering haze; its walls are not rendered
+                    auto obj = std::make_unique<raytracer::Prism>(raytracer::Vec3(4, 4, 4), makeUnique("Haze"));
+                    obj->medium.kind = raytracer::MediumKind::Homogeneous;
+                    obj->medium.density = 0.3f;
+                    obj->medium.anisotropy = 0.6f;
+                    created = std::move(obj);
+                    break;
+                }
+                case 7: {
+                    const std::string path = addObjectDialog->GetSelectedPath();
+                    std::shared_ptr<raytracer::MeshData> data;
+                    try {
+                        data = raytracer::LoadMesh(path);
+                    } catch (const std::exception& e) {
+                        std::cerr << "Failed to load mesh: " << e.what() << std::endl;
+                        return;
+                    }
+                    static bool debugRender = std::getenv("MYZEMAX_DEBUG_RENDER") != nullptr;
+                    if (debugRender) {
+                        std::cout << "[render] loaded mesh " << path << ": " << data->TriangleCount() << " triangles, "
+                                  << data->MemoryBytes() / (1024 * 1024) << " MB\n";
+                    }
+                    auto obj = std::make_unique<raytracer::Mesh>(
+                        std::move(data), makeUnique(std::filesystem::path(path).stem().string()));
+                    obj->sourcePath = path;
+                    created = std::move(obj);
+                    break;
+                }
                 default:
                     return;
             }
@@ -1,6 +1,12 @@
 #include "ui/objects_panel.hpp"
 #include "raytracer/object.hpp"
 #include "raytracer/objects.hpp"
+#include "raytracer/mesh.hpp"
+#include "raytracer/instance.hpp"
+#include "raytracer/quadric.hpp"
+#include "raytracer/csg.hpp"
+#include "raytracer/lens.hpp"
+#include "raytracer/sdf.hpp"
 #include "dr4/math/rect.hpp"
 #include "hui/event.hpp"
 #include "hui/ui.hpp"
@@ -288,6 +294,16 @@ std::string ObjectsPanel::GetTypeLabel(const raytracer::Object* obj) const {
     if (dynamic_cast<const raytracer::Disk*>(obj)) return "[Disk]";
     if (dynamic_cast<const raytracer::Prism*>(obj)) return "[Prism]";
     if (dynamic_cast<const raytracer::Pyramid*>(obj)) return "[Pyramid]";
+    if (auto* quadric = dynamic_cast<const raytracer::Quadric*>(obj)) {
+        return std::string("[") + raytracer::QuadricKindName(quadric->Kind()) + "]";
+    }
+    if (auto* csg = dynamic_cast<const raytracer::Csg*>(obj)) {
+        return std::string("[") + raytracer::CsgOpName(csg->Op()) + "]";
+    }
+    if (dynamic_cast<const raytracer::Lens*>(obj)) return "[Lens]";
+    if (dynamic_cast<const raytracer::Sdf*>(obj)) return "[SDF]";
+    if (dynamic_cast<const raytracer::Mesh*>(obj)) return "[Mesh]";
+    if (dynamic_cast<const raytracer::Instance*>(obj)) return "[Instance]";
     return "[Obj]";
 }
 
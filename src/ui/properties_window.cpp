@@ -1,11 +1,18 @@
 #include "ui/properties_window.hpp"
 #include "raytracer/object.hpp"
 #include "raytracer/objects.hpp"
+#include "raytracer/mesh.hpp"
+#include "raytracer/instance.hpp"
+#include "raytracer/quadric.hpp"
+#include "raytracer/csg.hpp"
+#include "raytracer/lens.hpp"
+#include "raytracer/sdf.hpp"
 #include "raytracer/scene.hpp"
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
 #include <cctype>
+#include <iostream>
 #include "dr4/keycodes.hpp"
 #include "dr4/math/rect.hpp"
 #include "hui/event.hpp"
@@ -118,6 +125,15 @@ void PropertiesWindow::UpdateFromObject() {
         diskNxText = diskNyText = diskNzText = "";
         prismSizeXText = prismSizeYText = prismSizeZText = "";
         pyramidBaseText = pyramidHeightText = "";
+        quadricRadiusText = quadricHeightText = quadricCapsText = quadricWaistText = "";
+        lensFrontRText = lensFrontKText = lensFrontA4Text = lensFrontA6Text = "";
+        lensBackRText = lensBackKText = lensBackA4Text = lensBackA6Text = "";
+        lensThicknessText = lensApertureText = lensGlassText = "";
+        sdfBlendText = sdfMaxStepsText = "";
+        rotXText = rotYText = rotZText = "";
+        scaleXText = scaleYText = scaleZText = "";
+        textureText = textureScaleText = color2RText = color2GText = color2BText = "";
+        mediumText = mediumDensityText = mediumAnisotropyText = "";
         return;
     }
     
@@ -152,6 +168,27 @@ void PropertiesWindow::UpdateFromObject() {
     oss << currentObject->reflectivity;
     reflectivityText = oss.str();
 
+    const raytracer::Vec3& rotation = currentObject->GetRotation();
+    const raytracer::Vec3& scale = currentObject->GetScale();
+    oss.str(""); oss << rotation.x; rotXText = oss.str();
+    oss.str(""); oss << rotation.y; rotYText = oss.str();
+    oss.str(""); oss << rotation.z; rotZText = oss.str();
+    oss.str(""); oss << scale.x; scaleXText = oss.str();
+    oss.str(""); oss << scale.y; scaleYText = oss.str();
+    oss.str(""); oss << scale.z; scaleZText = oss.str();
+
+    const raytracer::Texture& texture = currentObject->texture;
+    textureText = raytracer::TextureKindName(texture.kind);
+    oss.str(""); oss << texture.scale; textureScaleText = oss.str();
+    color2RText = std::to_string(texture.color2.r);
+    color2GText = std::to_string(texture.color2.g);
+    color2BText = std::to_string(texture.color2.b);
+
+    const raytracer::Medium& medium = currentObject->medium;
+    mediumText = raytracer::MediumKindName(medium.kind);
+    oss.str(""); oss << medium.density; mediumDensityText = oss.str();
+    oss.str(""); oss << medium.anisotropy; mediumAnisotropyText = oss.str();
+
     sphereRadiusText.clear();
     planeNxText.clear(); planeNyText.clear(); planeNzText.clear();
     rectPlaneNxText.clear(); rectPlaneNyText.clear(); rectPlaneNzText.clear();
@@ -160,6 +197,11 @@ void PropertiesWindow::UpdateFromObject() {
     diskNxText.clear(); diskNyText.clear(); diskNzText.clear();
     prismSizeXText.clear(); prismSizeYText.clear(); prismSizeZText.clear();
     pyramidBaseText.clear(); pyramidHeightText.clear();
+    quadricRadiusText.clear(); quadricHeightText.clear(); quadricCapsText.clear(); quadricWaistText.clear();
+    lensFrontRText.clear(); lensFrontKText.clear(); lensFrontA4Text.clear(); lensFrontA6Text.clear();
+    lensBackRText.clear(); lensBackKText.clear(); lensBackA4Text.clear(); lensBackA6Text.clear();
+    lensThicknessText.clear(); lensApertureText.clear(); lensGlassText.clear();
+    sdfBlendText.clear(); sdfMaxStepsText.clear();
 
     currentKind = ObjKind::Unknown;
     if (auto* s = dynamic_cast<raytracer::Sphere*>(currentObject)) {
@@ -194,10 +236,44 @@ void PropertiesWindow::UpdateFromObject() {
         currentKind = ObjKind::Pyramid;
         oss.str(""); oss << py->baseSize; pyramidBaseText = oss.str();
         oss.str(""); oss << py->height; pyramidHeightText = oss.str();
+    } else if (auto* q = dynamic_cast<raytracer::Quadric*>(currentObject)) {
+        currentKind = ObjKind::Quadric;
+        oss.str(""); oss << q->Radius(); quadricRadiusText = oss.str();
+        oss.str(""); oss << q->Height(); quadricHeightText = oss.str();
+        quadricCapsText = q->Capped() ? "1" : "0";
+        oss.str(""); oss << q->Waist(); quadricWaistText = oss.str();
+    } else if (auto* l = dynamic_cast<raytracer::Lens*>(currentObject)) {
+        currentKind = ObjKind::Lens;
+        // aspheric coefficients are small; no exponent, the fields take digits only
+        std::ostringstream coef;
+        coef << std::fixed << std::setprecision(8);
+        oss.str(""); oss << l->Front().radius; lensFrontRText = oss.str();
+        oss.str(""); oss << l->Front().conic; lensFrontKText = oss.str();
+        coef.str(""); coef << l->Front().asphere[0]; lensFrontA4Text = coef.str();
+        coef.str(""); coef << l->Front().asphere[1]; lensFrontA6Text = coef.str();
+        oss.str(""); oss << l->Back().radius; lensBackRText = oss.str();
+        oss.str(""); oss << l->Back().conic; lensBackKText = oss.str();
+        coef.str(""); coef << l->Back().asphere[0]; lensBackA4Text = coef.str();
+        coef.str(""); coef << l->Back().asphere[1]; lensBackA6Text = coef.str();
+        oss.str(""); oss << l->Thickness(); lensThicknessText = oss.str();
+        oss.str(""); oss << l->ClearAperture(); lensApertureText = oss.str();
+        lensGlassText = l->GlassName();
+    } else if (auto* sdf = dynamic_cast<raytracer::Sdf*>(currentObject)) {
+        currentKind = ObjKind::Sdf;
+        const auto& terms = sdf->Terms();
+        oss.str(""); oss << (terms.size() > 1 ? terms[1].blend : 0.0f); sdfBlendText = oss.str();
+        sdfMaxStepsText = std::to_string(sdf->MaxSteps());
     }
 }
 
+// Rotation X/Y/Z, Scale X/Y/Z, the texture and the medium fields follow the
+// per-kind fields.
 int PropertiesWindow::FieldCount() const {
+    if (!currentObject) return 0;
+    return ShapeFieldCount() + 14;
+}
+
+int PropertiesWindow::ShapeFieldCount() const {
     if (!currentObject) return 0;
     switch (currentKind) {
         case ObjKind::Sphere: return 10;
@@ -207,6 +283,12 @@ int PropertiesWindow::FieldCount() const {
         case ObjKind::Disk: return 13;
         case ObjKind::Prism: return 12;
         case ObjKind::Pyramid: return 11;
+        case ObjKind::Quadric: {
+            auto* q = dynamic_cast<raytracer::Quadric*>(currentObject);
+            return q && q->Kind() == raytracer::QuadricKind::Hyperboloid ? 13 : 12;
+        }
+        case ObjKind::Lens: return 20;
+        case ObjKind::Sdf: return 11;
         default: return 9;
     }
 }
@@ -352,7 +434,7 @@ void PropertiesWindow::Redraw() const {
     drawField("Refractive Index:", refractiveIndexText, 7, FieldValueOffset(7));
     drawField("Reflectivity:", reflectivityText, 8, FieldValueOffset(8));
 
-    int fc = FieldCount();
+    int fc = ShapeFieldCount();
     if (fc > 9) {
         if (currentKind == ObjKind::Sphere || currentKind == ObjKind::Light) {
             drawField("Radius:", sphereRadiusText, 9, FieldValueOffset(9));
@@ -378,8 +460,44 @@ void PropertiesWindow::Redraw() const {
         } else if (currentKind == ObjKind::Pyramid) {
             drawField("Base size:", pyramidBaseText, 9, FieldValueOffset(9));
             drawField("Height:", pyramidHeightText, 10, FieldValueOffset(10));
+        } else if (currentKind == ObjKind::Quadric) {
+            drawField("Radius:", quadricRadiusText, 9, FieldValueOffset(9));
+            drawField("Height:", quadricHeightText, 10, FieldValueOffset(10));
+            drawField("Caps (0/1):", quadricCapsText, 11, FieldValueOffset(11));
+            if (fc > 12) drawField("Waist:", quadricWaistText, 12, FieldValueOffset(12));
+        } else if (currentKind == ObjKind::Lens) {
+            drawField("Front R:", lensFrontRText, 9, FieldValueOffset(9));
+            drawField("Front k:", lensFrontKText, 10, FieldValueOffset(10));
+            drawField("Front A4:", lensFrontA4Text, 11, FieldValueOffset(11));
+            drawField("Front A6:", lensFrontA6Text, 12, FieldValueOffset(12));
+            drawField("Back R:", lensBackRText, 13, FieldValueOffset(13));
+            drawField("Back k:", lensBackKText, 14, FieldValueOffset(14));
+            drawField("Back A4:", lensBackA4Text, 15, FieldValueOffset(15));
+            drawField("Back A6:", lensBackA6Text, 16, FieldValueOffset(16));
+            drawField("Thickness:", lensThicknessText, 17, FieldValueOffset(17));
+            drawField("Aperture:", lensApertureText, 18, FieldValueOffset(18));
+            drawField("Glass:", lensGlassText, 19, FieldValueOffset(19));
+        } else if (currentKind == ObjKind::Sdf) {
+            drawField("Blend:", sdfBlendText, 9, FieldValueOffset(9));
+            drawField("Max steps:", sdfMaxStepsText, 10, FieldValueOffset(10));
         }
     }
+    if (currentObject) {
+        drawField("Rotation X:", rotXText, fc, FieldValueOffset(fc));
+        drawField("Rotation Y:", rotYText, fc + 1, FieldValueOffset(fc + 1));
+        drawField("Rotation Z:", rotZText, fc + 2, FieldValueOffset(fc + 2));
+        drawField("Scale X:", scaleXText, fc + 3, FieldValueOffset(fc + 3));
+        drawField("Scale Y:", scaleYText, fc + 4, FieldValueOffset(fc + 4));
+        drawField("Scale Z:", scaleZText, fc + 5, FieldValueOffset(fc + 5));
+        drawField("Texture:", textureText, fc + 6, FieldValueOffset(fc + 6));
+        drawField("Texture scale:", textureScaleText, fc + 7, FieldValueOffset(fc + 7));
+        drawField("Color 2 R:", color2RText, fc + 8, FieldValueOffset(fc + 8));
+        drawField("Color 2 G:", color2GText, fc + 9, FieldValueOffset(fc + 9));
+        drawField("Color 2 B:", color2BText, fc + 10, FieldValueOffset(fc + 10));
+        drawField("Medium:", mediumText, fc + 11, FieldValueOffset(fc + 11));
+        drawField("Density:", mediumDensityText, fc + 12, FieldValueOffset(fc + 12));
+        drawField("Anisotropy:", mediumAnisotropyText, fc + 13, FieldValueOffset(fc + 13));
+    }
 
     y += 5.0f;
 
@@ -482,8 +600,69 @@ void PropertiesWindow::ParseAndApplyChanges() {
     } else if (auto* py = dynamic_cast<raytracer::Pyramid*>(currentObject)) {
         try { py->baseSize = std::max(0.01f, std::stof(pyramidBaseText.empty() ? "1" : pyramidBaseText)); } catch (...) {}
         try { py->height = std::max(0.01f, std::stof(pyramidHeightText.empty() ? "1" : pyramidHeightText)); } catch (...) {}
+    } else if (auto* q = dynamic_cast<raytracer::Quadric*>(currentObject)) {
+        float radius = q->Radius(), height = q->Height(), waist = q->Waist();
+        bool capped = q->Capped();
+        try { radius = std::stof(quadricRadiusText); } catch (...) {}
+        try { height = std::stof(quadricHeightText); } catch (...) {}
+        try { capped = std::stoi(quadricCapsText) != 0; } catch (...) {}
+        try { waist = std::stof(quadricWaistText); } catch (...) {}
+        q->SetShape(radius, height, waist, capped);
+    } else if (auto* l = dynamic_cast<raytracer::Lens*>(currentObject)) {
+        raytracer::LensSurface front = l->Front(), back = l->Back();
+        float thickness = l->Thickness(), aperture = l->ClearAperture();
+        try { front.radius = std::stof(lensFrontRText); } catch (...) {}
+        try { front.conic = std::stof(lensFrontKText); } catch (...) {}
+        try { front.asphere[0] = std::stof(lensFrontA4Text); } catch (...) {}
+        try { front.asphere[1] = std::stof(lensFrontA6Text); } catch (...) {}
+        try { back.radius = std::stof(lensBackRText); } catch (...) {}
+        try { back.conic = std::stof(lensBackKText); } catch (...) {}
+        try { back.asphere[0] = std::stof(lensBackA4Text); } catch (...) {}
+        try { back.asphere[1] = std::stof(lensBackA6Text); } catch (...) {}
+        try { thickness = std::stof(lensThicknessText); } catch (...) {}
+        try { aperture = std::stof(lensApertureText); } catch (...) {}
+        l->SetShape(front, back, thickness, aperture);
+        // only a changed glass overrides the refractive index field
+        if (lensGlassText != l->GlassName() && !l->SetGlass(lensGlassText)) {
+            std::cout << "Unknown glass: " << lensGlassText << std::endl;
+        }
+    } else if (auto* sdf = dynamic_cast<raytracer::Sdf*>(currentObject)) {
+        // one blend for every join after the first primitive
+        try {
+            const float blend = std::max(0.0f, std::stof(sdfBlendText));
+            std::vector<raytracer::SdfTerm> terms = sdf->Terms();
+            for (size_t i = 1; i < terms.size(); ++i) terms[i].blend = blend;
+            sdf->SetTerms(std::move(terms));
+        } catch (...) {}
+        try { sdf->SetMaxSteps(std::stoi(sdfMaxStepsText)); } catch (...) {}
     }
 
+    raytracer::Vec3 rotation = currentObject->GetRotation();
+    raytracer::Vec3 scale = currentObject->GetScale();
+    try { rotation.x = std::stof(rotXText); } catch (...) {}
+    try { rotation.y = std::stof(rotYText); } catch (...) {}
+    try { rotation.z = std::stof(rotZText); } catch (...) {}
+    try { scale.x = std::max(0.01f, std::stof(scaleXText)); } catch (...) {}
+    try { scale.y = std::max(0.01f, std::stof(scaleYText)); } catch (...) {}
+    try { scale.z = std::max(0.01f, std::stof(scaleZText)); } catch (...) {}
+    currentObject->SetTransform(rotation, scale);
+
+    raytracer::Texture& texture = currentObject->texture;
+    if (!raytracer::ParseTextureKind(textureText, texture.kind)) {
+        std::cout << "Unknown texture: " << textureText << " (none, checker, grid, gradient, noise)" << std::endl;
+    }
+    try { texture.scale = std::max(0.01f, std::stof(textureScaleText)); } catch (...) {}
+    try { texture.color2.r = static_cast<uint8_t>(std::clamp(std::stoi(color2RText), 0, 255)); } catch (...) {}
+    try { texture.color2.g = static_cast<uint8_t>(std::clamp(std::stoi(color2GText), 0, 255)); } catch (...) {}
+    try { texture.color2.b = static_cast<uint8_t>(std::clamp(std::stoi(color2BText), 0, 255)); } catch (...) {}
+
+    raytracer::Medium& medium = currentObject->medium;
+    if (!raytracer::ParseMediumKind(mediumText, medium.kind)) {
+        std::cout << "Unknown medium: " << mediumText << " (none, homogeneous, heterogeneous)" << std::endl;
+    }
+    try { medium.density = std::max(0.0f, std::stof(mediumDensityText)); } catch (...) {}
+    try { medium.anisotropy = std::clamp(std::stof(mediumAnisotropyText), -0.95f, 0.95f); } catch (...) {}
+
     if (draftObject && draftScene && currentObject == draftObject.get()) {
         auto makeUnique = [this](const std::string& base) {
             if (!draftScene) return base;
@@ -513,6 +692,39 @@ void PropertiesWindow::ParseAndApplyChanges() {
 void PropertiesWindow::CopyObject() {
     if (currentObject) {
         copiedObject = CloneObject(currentObject);
+        copiedGeometry.reset();
+    }
+}
+
+void PropertiesWindow::PasteInstance(raytracer::Scene* scene) {
+    if (!copiedObject || !scene) return;
+
+    if (!copiedGeometry) {
+        if (auto* instance = dynamic_cast<raytracer::Instance*>(copiedObject)) {
+            copiedGeometry = instance->GetGeometry();
+        } else if (raytracer::Object* local = CloneShape(copiedObject)) {
+            local->position = raytracer::Vec3(0, 0, 0);
+            std::vector<std::unique_ptr<raytracer::Object>> objects;
+            objects.emplace_back(local);
+            copiedGeometry = std::make_shared<const raytracer::InstanceGeometry>(std::move(objects));
+        }
+        if (!copiedGeometry) return;
+    }
+
+    auto* instance = new raytracer::Instance(copiedGeometry, copiedObject->name + " (Instance)");
+    instance->position = copiedObject->position + raytracer::Vec3(1.0f, 0.0f, 0.0f);
+    instance->color = copiedObject->color;
+    instance->refractiveIndex = copiedObject->refractiveIndex;
+    instance->dispersion = copiedObject->dispersion;
+    instance->reflectivity = copiedObject->reflectivity;
+    instance->texture = copiedObject->texture;
+    instance->medium = copiedObject->medium;
+    instance->SetTransform(copiedObject->GetRotation(), copiedObject->GetScale());
+
+    scene->AddObject(std::unique_ptr<raytracer::Object>(instance));
+    SetObject(instance);
+    if (onObjectChanged) {
+        onObjectChanged();
     }
 }
 
@@ -530,52 +742,131 @@ void PropertiesWindow::PasteObject(raytracer::Scene* scene) {
     }
 }
 
-raytracer::Object* PropertiesWindow::CloneObject(raytracer::Object* obj) const {
+raytracer::Object* PropertiesWindow::CloneObject(const raytracer::Object* obj) const {
+    raytracer::Object* copy = CloneShape(obj);
+    if (copy) {
+        copy->SetTransform(obj->GetRotation(), obj->GetScale());
+        copy->texture = obj->texture;
+        copy->medium = obj->medium;
+    }
+    return copy;
+}
+
+// Copy without rotation and scale.
+raytracer::Object* PropertiesWindow::CloneShape(const raytracer::Object* obj) const {
     if (!obj) return nullptr;
     
-    if (auto* sphere = dynamic_cast<raytracer::Sphere*>(obj)) {
+    if (auto* sphere = dynamic_cast<const raytracer::Sphere*>(obj)) {
         auto* newSphere = new raytracer::Sphere(sphere->radius, sphere->name);
         newSphere->position = sphere->position;
         newSphere->color = sphere->color;
         newSphere->refractiveIndex = sphere->refractiveIndex;
+        newSphere->dispersion = sphere->dispersion;
         newSphere->reflectivity = sphere->reflectivity;
         newSphere->isLightSource = sphere->isLightSource;
         return newSphere;
-    } else if (auto* plane = dynamic_cast<raytracer::Plane*>(obj)) {
+    } else if (auto* plane = dynamic_cast<const raytracer::Plane*>(obj)) {
         auto* newPlane = new raytracer::Plane(plane->normal, plane->name);
         newPlane->position = plane->position;
         newPlane->color = plane->color;
         newPlane->refractiveIndex = plane->refractiveIndex;
+        newPlane->dispersion = plane->dispersion;
         newPlane->reflectivity = plane->reflectivity;
         return newPlane;
-    } else if (auto* rp = dynamic_cast<raytracer::RectPlane*>(obj)) {
+    } else if (auto* rp = dynamic_cast<const raytracer::RectPlane*>(obj)) {
         auto* newRect = new raytracer::RectPlane(rp->width, rp->height, rp->normal, rp->name);
         newRect->position = rp->position;
         newRect->color = rp->color;
         newRect->refractiveIndex = rp->refractiveIndex;
+        newRect->dispersion = rp->dispersion;
         newRect->reflectivity = rp->reflectivity;
         return newRect;
-    } else if (auto* disk = dynamic_cast<raytracer::Disk*>(obj)) {
+    } else if (auto* disk = dynamic_cast<const raytracer::Disk*>(obj)) {
         auto* newDisk = new raytracer::Disk(disk->radius, disk->normal, disk->name);
         newDisk->position = disk->position;
         newDisk->color = disk->color;
         newDisk->refractiveIndex = disk->refractiveIndex;
+        newDisk->dispersion = disk->dispersion;
         newDisk->reflectivity = disk->reflectivity;
         return newDisk;
-    } else if (auto* prism = dynamic_cast<raytracer::Prism*>(obj)) {
+    } else if (auto* prism = dynamic_cast<const raytracer::Prism*>(obj)) {
         auto* newPrism = new raytracer::Prism(prism->size, prism->name);
         newPrism->position = prism->position;
         newPrism->color = prism->color;
         newPrism->refractiveIndex = prism->refractiveIndex;
+        newPrism->dispersion = prism->dispersion;
         newPrism->reflectivity = prism->reflectivity;
         return newPrism;
-    } else if (auto* pyramid = dynamic_cast<raytracer::Pyramid*>(obj)) {
+    } else if (auto* pyramid = dynamic_cast<const raytracer::Pyramid*>(obj)) {
         auto* newPyramid = new raytracer::Pyramid(pyramid->baseSize, pyramid->height, pyramid->name);
         newPyramid->position = pyramid->position;
         newPyramid->color = pyramid->color;
         newPyramid->refractiveIndex = pyramid->refractiveIndex;
+        newPyramid->dispersion = pyramid->dispersion;
         newPyramid->reflectivity = pyramid->reflectivity;
         return newPyramid;
+    } else if (auto* quadric = dynamic_cast<const raytracer::Quadric*>(obj)) {
+        auto* newQuadric = new raytracer::Quadric(quadric->Kind(), quadric->Radius(), quadric->Height(), quadric->name);
+        newQuadric->SetShape(quadric->Radius(), quadric->Height(), quadric->Waist(), quadric->Capped());
+        newQuadric->position = quadric->position;
+        newQuadric->color = quadric->color;
+        newQuadric->refractiveIndex = quadric->refractiveIndex;
+        newQuadric->dispersion = quadric->dispersion;
+        newQuadric->reflectivity = quadric->reflectivity;
+        return newQuadric;
+    } else if (auto* lens = dynamic_cast<const raytracer::Lens*>(obj)) {
+        auto* newLens = new raytracer::Lens(lens->Front(), lens->Back(), lens->Thickness(), lens->ClearAperture(),
+                                            lens->name);
+        newLens->SetGlass(lens->GlassName());
+        newLens->position = lens->position;
+        newLens->color = lens->color;
+        newLens->refractiveIndex = lens->refractiveIndex;
+        newLens->dispersion = lens->dispersion;
+        newLens->reflectivity = lens->reflectivity;
+        return newLens;
+    } else if (auto* sdf = dynamic_cast<const raytracer::Sdf*>(obj)) {
+        auto* newSdf = new raytracer::Sdf(sdf->Terms(), sdf->name);
+        newSdf->SetMaxSteps(sdf->MaxSteps());
+        newSdf->SetLipschitz(sdf->Lipschitz());
+        newSdf->position = sdf->position;
+        newSdf->color = sdf->color;
+        newSdf->refractiveIndex = sdf->refractiveIndex;
+        newSdf->dispersion = sdf->dispersion;
+        newSdf->reflectivity = sdf->reflectivity;
+        return newSdf;
+    } else if (auto* csg = dynamic_cast<const raytracer::Csg*>(obj)) {
+        raytracer::Object* left = CloneObject(&csg->Left());
+        raytracer::Object* right = CloneObject(&csg->Right());
+        if (!left || !right) {
+            delete left;
+            delete right;
+            return nullptr;
+        }
+        auto* newCsg = new raytracer::Csg(csg->Op(), std::unique_ptr<raytracer::Object>(left),
+                                          std::unique_ptr<raytracer::Object>(right), csg->name);
+        newCsg->position = csg->position;
+        newCsg->color = csg->color;
+        newCsg->refractiveIndex = csg->refractiveIndex;
+        newCsg->dispersion = csg->dispersion;
+        newCsg->reflectivity = csg->reflectivity;
+        return newCsg;
+    } else if (auto* instance = dynamic_cast<const raytracer::Instance*>(obj)) {
+        auto* newInstance = new raytracer::Instance(instance->GetGeometry(), instance->name);
+        newInstance->position = instance->position;
+        newInstance->color = instance->color;
+        newInstance->refractiveIndex = instance->refractiveIndex;
+        newInstance->dispersion = instance->dispersion;
+        newInstance->reflectivity = instance->reflectivity;
+        return newInstance;
+    } else if (auto* mesh = dynamic_cast<const raytracer::Mesh*>(obj)) {
+        auto* newMesh = new raytracer::Mesh(mesh->data, mesh->name);
+        newMesh->sourcePath = mesh->sourcePath;
+        newMesh->position = mesh->position;
+        newMesh->color = mesh->color;
+        newMesh->refractiveIndex = mesh->refractiveIndex;
+        newMesh->dispersion = mesh->dispersion;
+        newMesh->reflectivity = mesh->reflectivity;
+        return newMesh;
     }
     
     return nullptr;
@@ -611,7 +902,7 @@ hui::EventResult PropertiesWindow::OnKeyDown(hui::KeyEvent& evt) {
         return hui::EventResult::HANDLED;
     }
     if (activeField < 0 && ctrl && evt.key == dr4::KEYCODE_C) { if (currentObject) CopyObject(); return hui::EventResult::HANDLED; }
-    if (activeField < 0 && ctrl && evt.key == dr4::KEYCODE_V) { if (onPasteRequest) onPasteRequest(); return hui::EventResult::HANDLED; }
+    if (activeField < 0 && ctrl && evt.key == dr4::KEYCODE_V) { if (onPasteRequest) onPasteRequest((evt.mods & dr4::KEYMOD_SHIFT) != 0); return hui::EventResult::HANDLED; }
     if (activeField >= 0) {
         if (auto* field = GetFieldByIndex(activeField)) {
             caretPos = std::min(caretPos, field->size());
@@ -865,7 +1156,7 @@ hui::EventResult PropertiesWindow::OnMouseUp(hui::MouseButtonEvent& evt) {
 
             if (fire) {
                 if (toFire == ButtonId::Copy) CopyObject();
-                else if (toFire == ButtonId::Paste) { if (onPasteRequest) onPasteRequest(); }
+                else if (toFire == ButtonId::Paste) { if (onPasteRequest) onPasteRequest(false); }
                 else if (toFire == ButtonId::Enter) ParseAndApplyChanges();
                 return hui::EventResult::HANDLED;
             }
@@ -876,6 +1167,32 @@ hui::EventResult PropertiesWindow::OnMouseUp(hui::MouseButtonEvent& evt) {
 }
 
 std::string* PropertiesWindow::GetFieldByIndex(int idx) {
+    const int transformField = idx - ShapeFieldCount();
+    if (currentObject && transformField >= 0) {
+        switch (transformField) {
+            case 0: return &rotXText;
+            case 1: return &rotYText;
+            case 2: return &rotZText;
+            case 3: return &scaleXText;
+            case 4: return &scaleYText;
+            case 5: return &scaleZText;
+            case 6: return &textureText;
+            case 7: return &textureScaleText;
+            case 8: return &color2RText;
+            case 9: return &color2GText;
+            case 10: return &color2BText;
+            case 11: return &mediumText;
+            case 12: return &mediumDensityText;
+            case 13: return &mediumAnisotropyText;
+            default: return nullptr;
+        }
+    }
+    if (currentKind == ObjKind::Lens && idx >= 9) {
+        std::string* lensFields[] = {&lensFrontRText, &lensFrontKText, &lensFrontA4Text, &lensFrontA6Text,
+                                     &lensBackRText, &lensBackKText, &lensBackA4Text, &lensBackA6Text,
+                                     &lensThicknessText, &lensApertureText, &lensGlassText};
+        return lensFields[idx - 9];
+    }
     switch (idx) {
         case 0: return &nameText;
         case 1: return &posXText;
@@ -893,6 +1210,8 @@ std::string* PropertiesWindow::GetFieldByIndex(int idx) {
             if (currentKind == ObjKind::Disk) return &diskRadiusText;
             if (currentKind == ObjKind::Prism) return &prismSizeXText;
             if (currentKind == ObjKind::Pyramid) return &pyramidBaseText;
+            if (currentKind == ObjKind::Quadric) return &quadricRadiusText;
+            if (currentKind == ObjKind::Sdf) return &sdfBlendText;
             return nullptr;
         case 10:
             if (currentKind == ObjKind::Plane) return &planeNyText;
@@ -900,16 +1219,20 @@ std::string* PropertiesWindow::GetFieldByIndex(int idx) {
             if (currentKind == ObjKind::Disk) return &diskNxText;
             if (currentKind == ObjKind::Prism) return &prismSizeYText;
             if (currentKind == ObjKind::Pyramid) return &pyramidHeightText;
+            if (currentKind == ObjKind::Quadric) return &quadricHeightText;
+            if (currentKind == ObjKind::Sdf) return &sdfMaxStepsText;
             return nullptr;
         case 11:
             if (currentKind == ObjKind::Plane) return &planeNzText;
             if (currentKind == ObjKind::RectPlane) return &rectPlaneNzText;
             if (currentKind == ObjKind::Disk) return &diskNyText;
             if (currentKind == ObjKind::Prism) return &prismSizeZText;
+            if (currentKind == ObjKind::Quadric) return &quadricCapsText;
             return nullptr;
         case 12:
             if (currentKind == ObjKind::RectPlane) return &rectPlaneWidthText;
             if (currentKind == ObjKind::Disk) return &diskNzText;
+            if (currentKind == ObjKind::Quadric) return &quadricWaistText;
             return nullptr;
         case 13:
             if (currentKind == ObjKind::RectPlane) return &rectPlaneHeightText;
@@ -919,6 +1242,9 @@ std::string* PropertiesWindow::GetFieldByIndex(int idx) {
 }
 
 bool PropertiesWindow::IsNumericField(int idx) const {
+    if (currentKind == ObjKind::Lens && idx == 19) return false;  // glass name
+    if (currentObject && idx == ShapeFieldCount() + 6) return false;  // texture name
+    if (currentObject && idx == ShapeFieldCount() + 11) return false;  // medium name
     return idx >= 1;
 }
 
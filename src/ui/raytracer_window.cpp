@@ -1,8 +1,10 @@
 #include "ui/raytracer_window.hpp"
+#include "raytracer/alloc_counter.hpp"
 #include "raytracer/objects.hpp"
 #include "dr4/keycodes.hpp"
 #include <array>
 #include <cmath>
+#include <cstdio>
 #include <algorithm>
 #include "hui/event.hpp"
 #include "hui/ui.hpp"
@@ -20,18 +22,42 @@ void RayTracerWindow::MarkDirty() {
     static bool debugRender = std::getenv("MYZEMAX_DEBUG_RENDER") != nullptr;
     needsRender = true;
     renderDelayFrames = 0;
+    if (raytracer) {
+        raytracer->ResetAccumulation();
+    }
     if (debugRender) {
         std::cout << "[render] MarkDirty -> needsRender=1\n";
     }
     ForceRedraw();
 }
 
+void RayTracerWindow::SetSelectedObject(raytracer::Object* obj) {
+    selectedObject = obj;
+    selectedObjects.clear();
+    if (obj) selectedObjects.push_back(obj);
+    ForceRedraw();
+}
+
 void RayTracerWindow::SetSelectedObject(const raytracer::Object* obj) {
-    selectedObject = const_cast<raytracer::Object*>(obj);
+    SetSelectedObject(const_cast<raytracer::Object*>(obj));
+}
+
+void RayTracerWindow::SelectObjects(std::vector<raytracer::Object*> objs) {
+    selectedObjects = std::move(objs);
+    selectedObject = selectedObjects.empty() ? nullptr : selectedObjects.front();
     ForceRedraw();
+    if (selectedObject && onObjectSelected) {
+        onObjectSelected(selectedObject);
+    }
 }
 
 void RayTracerWindow::Redraw() const {
+    const uint64_t allocationsBefore = raytracer::HeapAllocationCount();
+    RedrawContents();
+    lastRedrawAllocations = raytracer::HeapAllocationCount() - allocationsBefore;
+}
+
+void RayTracerWindow::RedrawContents() const {
     static bool debugRender = std::getenv("MYZEMAX_DEBUG_RENDER") != nullptr;
     dr4::Texture& texture = GetTexture();
     const dr4::Color bgViewport(22, 22, 28);
@@ -45,26 +71,55 @@ void RayTracerWindow::Redraw() const {
     float viewportWidth = GetSize().x;
 
 
-    auto* bar = GetUI()->GetWindow()->CreateRectangle();
-    bar->SetPos(dr4::Vec2f(0, 0));
-    bar->SetSize(dr4::Vec2f(GetSize().x, titleBarHeight));
-    bar->SetFillColor(bgHeader);
-    bar->SetBorderColor(borderHeader);
-    bar->SetBorderThickness(1.0f);
-    texture.Draw(*bar);
+    if (!headerBar) {
+        headerBar = GetUI()->GetWindow()->CreateRectangle();
+        headerBar->SetPos(dr4::Vec2f(0, 0));
+        headerBar->SetFillColor(bgHeader);
+        headerBar->SetBorderColor(borderHeader);
+        headerBar->SetBorderThickness(1.0f);
+    }
+    headerBar->SetSize(dr4::Vec2f(GetSize().x, titleBarHeight));
+    texture.Draw(*headerBar);
+
+    // the title is formatted into a reused buffer and only sent to the text
+    // object when it changes
+    char status[128];
+    titleBuffer = "Ray Tracer";
+    if (raytracer && raytracer->integrator == raytracer::Integrator::PathTrace) {
+        std::snprintf(status, sizeof(status), "  |  %spath tracing, %d spp, %.2f Msamples/s",
+                      raytracer->spectral ? "spectral " : "", raytracer->GetAccumulatedFrames(),
+                      raytracer->GetSamplesPerSecond() / 1e6);
+        titleBuffer += status;
+    }
+    if (raytracer && raytracer->WasLastFrameDenoised()) {
+        std::snprintf(status, sizeof(status), "  |  denoise %.1f ms", raytracer->GetLastDenoiseSeconds() * 1e3);
+        titleBuffer += status;
+    }
 
-    auto* titleText = GetUI()->GetWindow()->CreateText();
-    titleText->SetText("Ray Tracer");
-    titleText->SetPos(dr4::Vec2f(10, 6));
-    titleText->SetFontSize(14);
-    titleText->SetColor(textMain);
+    if (!titleText) {
+        titleText = GetUI()->GetWindow()->CreateText();
+        titleText->SetPos(dr4::Vec2f(10, 6));
+        titleText->SetFontSize(14);
+        titleText->SetColor(textMain);
+        titleText->SetText(titleBuffer);
+        shownTitle = titleBuffer;
+    } else if (titleBuffer != shownTitle) {
+        titleText->SetText(titleBuffer);
+        shownTitle = titleBuffer;
+    }
     texture.Draw(*titleText);
 
-    auto* arrowText = GetUI()->GetWindow()->CreateText();
-    arrowText->SetText(isCollapsed ? ">" : "v");
+    if (!arrowText) {
+        arrowText = GetUI()->GetWindow()->CreateText();
+        arrowText->SetFontSize(14);
+        arrowText->SetColor(textMain);
+        arrowText->SetText(isCollapsed ? ">" : "v");
+        shownCollapsed = isCollapsed;
+    } else if (shownCollapsed != isCollapsed) {
+        arrowText->SetText(isCollapsed ? ">" : "v");
+        shownCollapsed = isCollapsed;
+    }
     arrowText->SetPos(dr4::Vec2f(GetSize().x - 20, 6));
-    arrowText->SetFontSize(14);
-    arrowText->SetColor(textMain);
     texture.Draw(*arrowText);
 
     if (isCollapsed) {
@@ -100,7 +155,13 @@ void RayTracerWindow::Redraw() const {
         raytracer->Render(renderImage);
         needsRender = false;
         if (debugRender) {
-            std::cout << "[render] rendered frame\n";
+            const raytracer::RenderStats& stats = raytracer->GetLastStats();
+            std::cout << "[render] rendered frame in " << stats.frameSeconds * 1e3 << " ms: "
+                      << stats.primaryRays << " primary, " << stats.secondaryRays << " secondary, "
+                      << stats.shadowRays << " shadow rays, " << stats.intersectionTests << " tests, " << stats.marchSteps << " march steps, "
+                      << stats.RaysPerSecond() / 1e6 << " Mrays/s, " << stats.threads << " threads at "
+                      << stats.threadUtilization * 100.0 << "%, " << raytracer->GetLastFrameAllocations()
+                      << " allocations in Render, " << lastRedrawAllocations << " in previous Redraw\n";
         }
     } else if (needsRender && debugRender && !renderImage) {
         std::cout << "[render] cannot render: renderImage is null\n";
@@ -112,12 +173,28 @@ void RayTracerWindow::Redraw() const {
         texture.Draw(*renderImage);
     }
     
-    if (selectedObject) {
-        DrawSelectionBox(texture, selectedObject);
+    if (hoveredObject && std::find(selectedObjects.begin(), selectedObjects.end(), hoveredObject) == selectedObjects.end()) {
+        DrawSelectionBox(texture, hoveredObject, dr4::Color(150, 190, 255), 1.0f);
+    }
+    for (auto* obj : selectedObjects) {
+        DrawSelectionBox(texture, obj);
+    }
+
+    if (boxSelecting) {
+        if (!bandRect) {
+            bandRect = GetUI()->GetWindow()->CreateRectangle();
+            bandRect->SetFillColor(dr4::Color(120, 170, 230, 50));
+            bandRect->SetBorderColor(dr4::Color(120, 170, 230));
+            bandRect->SetBorderThickness(1.0f);
+        }
+        bandRect->SetPos(dr4::Vec2f(std::min(boxStart.x, boxEnd.x), std::min(boxStart.y, boxEnd.y)));
+        bandRect->SetSize(dr4::Vec2f(std::fabs(boxEnd.x - boxStart.x), std::fabs(boxEnd.y - boxStart.y)));
+        texture.Draw(*bandRect);
     }
 }
 
-void RayTracerWindow::DrawSelectionBox(dr4::Texture& texture, raytracer::Object* obj) const {
+void RayTracerWindow::DrawSelectionBox(dr4::Texture& texture, raytracer::Object* obj,
+                                       dr4::Color color, float thickness) const {
     raytracer::Vec3 min, max;
     obj->GetBoundingBox(min, max);
 
@@ -145,13 +222,15 @@ void RayTracerWindow::DrawSelectionBox(dr4::Texture& texture, raytracer::Object*
         return;
     }
 
-    auto* rect = GetUI()->GetWindow()->CreateRectangle();
-    rect->SetPos(dr4::Vec2f(screenMinX, screenMinY));
-    rect->SetSize(dr4::Vec2f(screenMaxX - screenMinX, screenMaxY - screenMinY));
-    rect->SetFillColor(dr4::Color(0, 0, 0, 0));
-    rect->SetBorderColor(dr4::Color(255, 255, 0));
-    rect->SetBorderThickness(2.0f);
-    texture.Draw(*rect);
+    if (!selectionRect) {
+        selectionRect = GetUI()->GetWindow()->CreateRectangle();
+        selectionRect->SetFillColor(dr4::Color(0, 0, 0, 0));
+    }
+    selectionRect->SetPos(dr4::Vec2f(screenMinX, screenMinY));
+    selectionRect->SetSize(dr4::Vec2f(screenMaxX - screenMinX, screenMaxY - screenMinY));
+    selectionRect->SetBorderColor(color);
+    selectionRect->SetBorderThickness(thickness);
+    texture.Draw(*selectionRect);
 }
 
 hui::EventResult RayTracerWindow::OnMouseDown(hui::MouseButtonEvent& evt) {
@@ -185,34 +264,14 @@ hui::EventResult RayTracerWindow::OnMouseDown(hui::MouseButtonEvent& evt) {
     if (isCollapsed) {
         return hui::EventResult::UNHANDLED;
     }
-    if (evt.button == dr4::MouseButtonType::LEFT && scene && camera && !isCollapsed) {
-        float screenX = evt.pos.x;
-        float screenY = evt.pos.y - titleBarHeight;
-        if (screenY < 0) return hui::EventResult::HANDLED;
-        
+    if (evt.button == dr4::MouseButtonType::LEFT && raytracer && !isCollapsed) {
         float viewportH = std::max(1.0f, GetSize().y - titleBarHeight);
-        if (screenX >= 0 && screenX < GetSize().x && screenY >= 0 && screenY < viewportH) {
-            raytracer::Ray ray = camera->GetRay(screenX, screenY, GetSize().x, viewportH);
-            raytracer::HitResult closestHit;
-            closestHit.t = 1e10f;
-            
-            for (auto& obj : scene->objects) {
-                raytracer::HitResult hit = obj->Intersect(ray);
-                if (hit.hit && hit.t < closestHit.t && hit.t > 0.001f) {
-                    closestHit = hit;
-                }
-            }
-            
-            if (closestHit.hit && closestHit.object) {
-                SetSelectedObject(closestHit.object);
-                if (onObjectSelected) {
-                    onObjectSelected(const_cast<raytracer::Object*>(closestHit.object));
-                }
-                if (debugInput) {
-                    std::cout << "[ui] RayTracerWindow select object via raycast\n";
-                }
-                return hui::EventResult::HANDLED;
-            }
+        if (evt.pos.x >= 0 && evt.pos.x < GetSize().x && evt.pos.y - titleBarHeight < viewportH) {
+            boxPending = true;
+            boxSelecting = false;
+            boxStart = boxEnd = evt.pos;
+            GetUI()->ReportFocus(this);
+            return hui::EventResult::HANDLED;
         }
     }
     
@@ -234,29 +293,113 @@ hui::EventResult RayTracerWindow::OnMouseMove(hui::MouseMoveEvent& evt) {
     if (debugInput) {
         std::cout << "[ui] RayTracerWindow MouseMove pos=(" << evt.pos.x << "," << evt.pos.y << ")\n";
     }
+    if (boxPending) {
+        boxEnd = evt.pos;
+        if (!boxSelecting && (std::fabs(boxEnd.x - boxStart.x) > 4.0f || std::fabs(boxEnd.y - boxStart.y) > 4.0f)) {
+            boxSelecting = true;
+        }
+        if (boxSelecting) ForceRedraw();
+        return hui::EventResult::HANDLED;
+    }
+    if (raytracer) {
+        raytracer::Object* hover = raytracer->PickObject(static_cast<int>(evt.pos.x),
+                                                         static_cast<int>(evt.pos.y - titleBarHeight));
+        if (hover != hoveredObject) {
+            hoveredObject = hover;
+            ForceRedraw();
+        }
+    }
     return Widget::OnMouseMove(evt);
 }
 
 hui::EventResult RayTracerWindow::OnKeyDown(hui::KeyEvent& evt) {
     if (evt.key == dr4::KEYCODE_V && (evt.mods & dr4::KEYMOD_CTRL)) {
         if (onPasteRequest) {
-            onPasteRequest();
+            onPasteRequest((evt.mods & dr4::KEYMOD_SHIFT) != 0);
+        }
+        return hui::EventResult::HANDLED;
+    }
+    if (evt.key == dr4::KEYCODE_P && (evt.mods & dr4::KEYMOD_CTRL) && raytracer) {
+        raytracer->integrator = raytracer->integrator == raytracer::Integrator::PathTrace
+                                    ? raytracer::Integrator::Preview
+                                    : raytracer::Integrator::PathTrace;
+        MarkDirty();
+        return hui::EventResult::HANDLED;
+    }
+    if (evt.key == dr4::KEYCODE_L && (evt.mods & dr4::KEYMOD_CTRL) && raytracer) {
+        raytracer->spectral = !raytracer->spectral;
+        if (raytracer->spectral) {
+            raytracer->integrator = raytracer::Integrator::PathTrace;
         }
+        MarkDirty();
+        return hui::EventResult::HANDLED;
+    }
+    if (evt.key == dr4::KEYCODE_H && (evt.mods & dr4::KEYMOD_CTRL) && scene) {
+        raytracer::Medium& haze = scene->medium;
+        haze.kind = haze.kind == raytracer::MediumKind::None ? raytracer::MediumKind::Homogeneous
+                                                             : raytracer::MediumKind::None;
+        MarkDirty();
+        return hui::EventResult::HANDLED;
+    }
+    if (evt.key == dr4::KEYCODE_R && (evt.mods & dr4::KEYMOD_CTRL) && raytracer) {
+        raytracer->previewReflections = !raytracer->previewReflections;
+        MarkDirty();
+        return hui::EventResult::HANDLED;
+    }
+    if (evt.key == dr4::KEYCODE_E && (evt.mods & dr4::KEYMOD_CTRL) && raytracer) {
+        raytracer->antialias = !raytracer->antialias;
+        needsRender = true;
+        ForceRedraw();
+        return hui::EventResult::HANDLED;
+    }
+    if (evt.key == dr4::KEYCODE_N && (evt.mods & dr4::KEYMOD_CTRL) && raytracer) {
+        raytracer->denoise = !raytracer->denoise;
+        needsRender = true;
+        ForceRedraw();
         return hui::EventResult::HANDLED;
     }
     return Widget::OnKeyDown(evt);
 }
 
 hui::EventResult RayTracerWindow::OnIdle(hui::IdleEvent& evt) {
-    (void)evt;
+    if (raytracer && !isCollapsed && !needsRender && !raytracer->IsConverged()) {
+        needsRender = true;
+        ForceRedraw();
+    }
     return Widget::OnIdle(evt);
 }
 
 hui::EventResult RayTracerWindow::OnMouseUp(hui::MouseButtonEvent& evt) {
+    static bool debugInput = std::getenv("MYZEMAX_DEBUG_INPUT") != nullptr;
     if (dragging) {
         dragging = false;
         return hui::EventResult::HANDLED;
     }
+    if (boxPending) {
+        boxPending = false;
+        if (raytracer) {
+            int x0 = static_cast<int>(boxStart.x);
+            int y0 = static_cast<int>(boxStart.y - titleBarHeight);
+            if (boxSelecting) {
+                boxSelecting = false;
+                int x1 = static_cast<int>(boxEnd.x);
+                int y1 = static_cast<int>(boxEnd.y - titleBarHeight);
+                auto picked = raytracer->PickObjectsInRect(x0, y0, x1, y1);
+                if (debugInput) {
+                    std::cout << "[ui] RayTracerWindow box select " << picked.size() << " object(s)\n";
+                }
+                SelectObjects(std::move(picked));
+            } else if (raytracer::Object* obj = raytracer->PickObject(x0, y0)) {
+                if (debugInput) {
+                    std::cout << "[ui] RayTracerWindow select object via id buffer\n";
+                }
+                SelectObjects({obj});
+            }
+        }
+        boxSelecting = false;
+        ForceRedraw();
+        return hui::EventResult::HANDLED;
+    }
     return Widget::OnMouseUp(evt);
 }
 